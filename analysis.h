@@ -25,59 +25,659 @@
 */
 
 #include "ariadne.h"
+#include "work-stealing-pool.h"
+#include "topology.h"
+#include "reach-stream.h"
+#include "instrumentation.h"
+#include "dynamics-kernel.h"
+#include "simulator.h"
+#include "symmetry.h"
+#include "outcome-database.h"
+#include "bdd-cell-set.h"
+#include "location-codec.h"
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <set>
+#include <sstream>
 
 using namespace Ariadne;
 
+namespace Ariadne {
+  /// Provided by system.h
+  HybridIOAutomaton getSystem(const PlantTopology& topology, int verbosity);
+  HybridIOAutomaton getTankSubsystem(const PlantTopology& topology, int k, std::vector<RealVariable>& inputs, DiscreteLocation& initial_location);
+  Box getTankBox(unsigned int tank_number, Interval valvelevel, Interval waterlevel);
+}
+
+// The plant under analysis. This is the original plant of system.h,
+// unless the main program replaces it to analyse another plant.
+PlantTopology analysed_topology = getPyramidTopology();
+
+// How the enclosures ending a window of the on-the-fly safety check in the same location are merged
+enum EnclosureMerging {
+  // Every enclosure is evolved on its own
+  MERGE_NONE,
+  // The enclosures are replaced by the box hull of their bounding boxes, within the error budget
+  MERGE_BOX_HULL
+};
+
+// Settings shared by the analyses
+struct AnalysisSettings {
+  // When not empty, the reached sets are written to files named with this prefix instead of being kept in
+  // memory for plotting; reach-render draws them offline. Each set is written once it is computed: an orbit
+  // of the finite time evolution once it ends, since the evolver returns it whole, hence one orbit for each
+  // worker is in memory at most, and a grid set at the end of its reach
+  String stream_prefix;
+  // When not empty, the profiler is enabled and its measures are written at the end to
+  // <prefix>.json and <prefix>.trace.json
+  String profile_prefix;
+  // When not empty, the outer and epsilon-lower reached sets are saved to files named with this prefix,
+  // and a later run with the same prefix starts from them (see load_warm_start)
+  String warm_start_prefix;
+  // The window over which the cells of a saved outer reach are evolved, to find the frontier of a warm start
+  double warm_start_window = 1.0;
+  // The maximum step size of the finite time evolutions
+  double maximum_step_size = 0.6;
+  // The accuracy of the grid of the outer and of the epsilon-lower reachability; the larger, the smaller the grid cells used
+  int outer_accuracy = 1;
+  int lower_accuracy = 2;
+  // The adaptive reaches start from the accuracies above and refine up to this one
+  int maximum_adaptive_accuracy = 4;
+  // The range of the water levels required by the safety specification
+  double safe_minimum_waterlevel = 5.25;
+  double safe_maximum_waterlevel = 8.25;
+  // The ranges of specific tanks, by index, overriding the one above where given
+  std::vector<Interval> safe_waterlevels;
+  // The ranges of the tanks in specific locations, by location name, overriding all the above
+  std::map< String, std::vector<Interval> > location_safe_waterlevels;
+  // Whether the grid reached sets are converted to binary decision diagrams before streaming, which
+  // merges the cells into few large boxes; the grid of the diagrams has 2^bdd_bits intervals along each
+  // dimension of the domain, hence it should be at least as fine as the grid of the accuracies above.
+  // The outer reach is then computed one initial location at a time, keeping only the diagram of the
+  // locations done, unless it is saved for a warm start. The diagrams only compress the computed results: each grid
+  // set is still built explicitly by the analyser before it is converted. Ignored if built without BuDDy
+  bool bdd_reach_sets = false;
+  unsigned int bdd_bits = 12;
+  // When not empty, the file of the database of the outcomes of the parametric verification:
+  // the boxes already decided in an earlier run are not verified again
+  String outcome_database;
+  // Whether the safety verification first looks for a counterexample, evolving the initial set
+  // window after window up to the horizon and stopping at the first definite violation
+  bool early_exit_safety = true;
+  double safety_window = 1.0;
+  double safety_horizon = 40.0;
+  // The on-the-fly check gives up when the enclosures to evolve in a window grow beyond this number
+  unsigned int maximum_safety_enclosures = 256;
+  // The merging of the enclosures ending a window in the same location at the same time, which bounds the
+  // splitting of the enclosures at the transitions which may or may not be taken, as those of controllers with
+  // a delta band. The error of merging two boxes is the largest excess, over all the variables, of the width of
+  // their hull over the larger of their two widths, in the units of the variable: the boxes are merged if it is
+  // at most the budget, hence the merge adds at most the budget to the width of any variable
+  EnclosureMerging safety_merging = MERGE_BOX_HULL;
+  double safety_merging_budget = 0.1;
+  // Whether the on-the-fly check drops the enclosures starting a window inside an earlier start of the same
+  // location, stopping before the horizon with an invariant once all of them are dropped
+  bool safety_fixpoint = true;
+};
+
+AnalysisSettings analysis_settings;
+
+// Builds a new system for the plant under analysis, for the workers which need their own system: the objects of
+// the library are not thread safe (see composition_lock), hence a system is never used by two threads at once
+HybridIOAutomaton getAnalysedSystem() {
+  return Ariadne::getSystem(analysed_topology,0);
+}
+
+// Builds an initial set over the state space of a worker's own system from the boxes of each location, so that
+// it shares nothing with the set the boxes were taken from, which must be made of boxes
+HybridBoundedConstraintSet getWorkerInitialSet(HybridAutomatonInterface& system, const HybridBoxes& boxes) {
+  HybridBoundedConstraintSet result(system.state_space());
+  for (HybridBoxes::const_iterator it = boxes.locations_begin(); it != boxes.locations_end(); ++it) {
+    if (!it->second.empty())
+      result[it->first] = it->second;
+  }
+  return result;
+}
+
 /// Forward declarations, used only to properly organize the source file
 void finite_time_upper_evolution(HybridAutomatonInterface& system, HybridBoundedConstraintSet& initial_set, int verbosity, bool plot_results);
 void finite_time_lower_evolution(HybridAutomatonInterface& system, HybridBoundedConstraintSet& initial_set, int verbosity, bool plot_results);
-HybridEvolver::EnclosureListType _finite_time_evolution(HybridAutomatonInterface& system, HybridBoundedConstraintSet& initial_set, Semantics semantics, int verbosity);
+HybridEvolver::EnclosureListType _finite_time_evolution(HybridAutomatonInterface& system, HybridBoundedConstraintSet& initial_set, Semantics semantics, int verbosity, ReachStreamWriter* sink = NULL);
 void infinite_time_outer_evolution(HybridAutomatonInterface& system, HybridBoundedConstraintSet& initial_set, int verbosity, bool plot_results);
 void infinite_time_epsilon_lower_evolution(HybridAutomatonInterface& system, HybridBoundedConstraintSet& initial_set, int verbosity, bool plot_results);
 void safety_verification(HybridAutomatonInterface& system, HybridBoundedConstraintSet& initial_set, int verbosity, bool plot_results);
 void parametric_safety_verification(HybridAutomatonInterface& system, HybridBoundedConstraintSet& initial_set, int verbosity, bool plot_results);
+void parallel_parametric_safety_verification(HybridAutomatonInterface& system, HybridBoundedConstraintSet& initial_set, int verbosity, bool plot_results);
+void compositional_outer_evolution(HybridAutomatonInterface& system, HybridBoundedConstraintSet& initial_set, int verbosity, bool plot_results);
+void adaptive_outer_evolution(HybridAutomatonInterface& system, HybridBoundedConstraintSet& initial_set, int verbosity, bool plot_results);
+void adaptive_epsilon_lower_evolution(HybridAutomatonInterface& system, HybridBoundedConstraintSet& initial_set, int verbosity, bool plot_results);
 HybridConstraintSet getSafetyConstraint(HybridAutomatonInterface& system);
 
-// The main method for the analysis of the system
-// Since the analyses are independent, you may comment out any one if you want
+// The signature shared by all the analysis routines
+typedef void (*AnalysisRoutine)(HybridAutomatonInterface&, HybridBoundedConstraintSet&, int, bool);
+
+// An analysis stage, i.e., a routine along with its label and whether it must be run
+struct AnalysisStage {
+  String name;
+  AnalysisRoutine routine;
+  bool enabled;
+};
+
+// Plotting is not meant to be used concurrently, hence the parallel workers
+// take this lock around each plot
+std::mutex plot_mutex;
+
+// The stages run by the analysis.
+// Since the analyses are independent, you may disable any one if you want
 // to focus on specific ones.
+std::vector<AnalysisStage> getAnalysisStages() {
+  std::vector<AnalysisStage> stages;
+  stages.push_back({"Finite time upper evolution", finite_time_upper_evolution, true});
+  stages.push_back({"Finite time lower evolution", finite_time_lower_evolution, true});
+  stages.push_back({"Infinite time outer evolution", infinite_time_outer_evolution, false});
+  stages.push_back({"Infinite time lower evolution", infinite_time_epsilon_lower_evolution, true});
+  stages.push_back({"Safety verification", safety_verification, false});
+  stages.push_back({"Parametric safety verification", parametric_safety_verification, false});
+  stages.push_back({"Parallel parametric safety verification", parallel_parametric_safety_verification, false});
+  stages.push_back({"Compositional outer estimate (unsound)", compositional_outer_evolution, false});
+  stages.push_back({"Adaptive outer evolution", adaptive_outer_evolution, false});
+  stages.push_back({"Adaptive lower evolution", adaptive_epsilon_lower_evolution, false});
+  return stages;
+}
+
+// The number of tanks of the system, deduced from the dimension of the initial set,
+// since there is a valve level and a water level for each tank
+unsigned int getTankNumber(HybridBoundedConstraintSet& initial_set) {
+  HybridBoxes initial_set_domain = initial_set.domain();
+  return initial_set_domain.locations_begin()->second.dimension() / 2;
+}
+
+// The names of the variables of the plant, for the given number of tanks, in the order used by the system
+std::vector<String> getTankVariableNames(unsigned int tank_number) {
+  std::vector<String> names;
+  for (unsigned int k = 0; k < tank_number; k++) {
+    names.push_back("valveLevel" + Ariadne::to_string(k));
+    names.push_back("waterLevel" + Ariadne::to_string(k));
+  }
+  std::sort(names.begin(),names.end());
+  return names;
+}
+
+// The positions of the water level and of the valve level of each tank among the variables of the system.
+// The variables are in alphabetical order, hence with more than ten tanks the positions of the tanks are
+// not in the order of their indices (waterLevel10 comes before waterLevel2).
+struct TankVariableIndices {
+  std::vector<unsigned int> waterlevel;
+  std::vector<unsigned int> valvelevel;
+};
+
+TankVariableIndices getTankVariableIndices(unsigned int tank_number) {
+  std::vector<String> names = getTankVariableNames(tank_number);
+  TankVariableIndices indices;
+  indices.waterlevel.resize(tank_number);
+  indices.valvelevel.resize(tank_number);
+  for (unsigned int k = 0; k < tank_number; k++) {
+    String number = Ariadne::to_string(k);
+    indices.waterlevel[k] = std::find(names.begin(),names.end(),"waterLevel" + number) - names.begin();
+    indices.valvelevel[k] = std::find(names.begin(),names.end(),"valveLevel" + number) - names.begin();
+  }
+  return indices;
+}
+
+// Creates the domain for the analyses, with the valve levels in [0,1] and the water levels in [4.5,9]
+HybridBoxes getAnalysisDomain(HybridAutomatonInterface& system, HybridBoundedConstraintSet& initial_set) {
+  return HybridBoxes(system.state_space(),getTankBox(getTankNumber(initial_set),Interval(0.0,1.0),Interval(4.5,9.0)));
+}
+
+// The safe range of the water level of each tank, in the given location if it has its own ranges
+std::vector<Interval> getSafeWaterLevels(unsigned int tank_number, const String& location = "") {
+  std::map< String, std::vector<Interval> >::const_iterator it = analysis_settings.location_safe_waterlevels.find(location);
+  if (it != analysis_settings.location_safe_waterlevels.end() && it->second.size() == tank_number)
+    return it->second;
+  std::vector<Interval> ranges(tank_number,Interval(analysis_settings.safe_minimum_waterlevel,analysis_settings.safe_maximum_waterlevel));
+  for (unsigned int k = 0; k < tank_number && k < analysis_settings.safe_waterlevels.size(); k++)
+    ranges[k] = analysis_settings.safe_waterlevels[k];
+  return ranges;
+}
+
+// The safe ranges of the water levels of every location, looked up by the code of the location: the names of the
+// locations with their own ranges are parsed once, when the table is built, and those which are not locations of
+// the whole plant are left out, as they are never looked up
+class SafeWaterLevelTable {
+
+    std::vector<Interval> _ranges;
+    std::map< LocationCode, std::vector<Interval> > _location_ranges;
+
+  public:
+
+    SafeWaterLevelTable(unsigned int tank_number) : _ranges(getSafeWaterLevels(tank_number)) {
+      LocationCodec codec(tank_number);
+      for (std::map< String, std::vector<Interval> >::const_iterator it = analysis_settings.location_safe_waterlevels.begin();
+           it != analysis_settings.location_safe_waterlevels.end(); ++it) {
+        LocationCode code;
+        if (it->second.size() == tank_number && codec.parse(it->first,code))
+          _location_ranges[code] = it->second;
+      }
+    }
+
+    const std::vector<Interval>& operator[](const LocationCode& code) const {
+      if (_location_ranges.empty())
+        return _ranges;
+      std::map< LocationCode, std::vector<Interval> >::const_iterator it = _location_ranges.find(code);
+      return (it != _location_ranges.end() ? it->second : _ranges);
+    }
+};
+
+// The main method for the analysis of the system, running the enabled stages one after another
 void analyse(HybridAutomatonInterface& system, HybridBoundedConstraintSet& initial_set, int verbosity, bool plot_results){
 
-  cout << "1/6: Finite time upper evolution... " << endl << flush;
-  finite_time_upper_evolution(system,initial_set,verbosity,plot_results);
+  std::vector<AnalysisStage> stages = getAnalysisStages();
+  for (unsigned int k = 0; k < stages.size(); k++) {
+    if (stages[k].enabled) {
+      cout << k+1 << "/" << stages.size() << ": " << stages[k].name << "... " << endl << flush;
+      Profiler::StageScope scope(stages[k].name);
+      Profiler::Timer timer(profiler,"stage");
+      stages[k].routine(system,initial_set,verbosity,plot_results);
+    }
+  }
+}
 
+// Runs the enabled stages at the same time, each one on its own worker thread.
+// Every worker builds its own system through getAnalysedSystem() and its own initial set from a copy of
+// the boxes of the given one, so that nothing is shared apart from the plotting lock. Outcomes and timings
+// are reported once all the workers have finished.
+void analyse_in_parallel(HybridBoundedConstraintSet& initial_set, int verbosity, bool plot_results){
 
-  cout << "2/6: Finite time lower evolution... " << endl << flush;
-  finite_time_lower_evolution(system,initial_set,verbosity,plot_results);
+  std::vector<AnalysisStage> stages = getAnalysisStages();
 
+  // The per-stage copies of the initial boxes, the elapsed times and the error messages, if any
+  std::vector<HybridBoxes> initial_boxes(stages.size(),initial_set.domain());
+  std::vector<double> elapsed(stages.size(),0.0);
+  std::vector<String> errors(stages.size());
 
-  /*
-  cout << "3/6: Infinite time outer evolution... " << endl << flush;
-  infinite_time_outer_evolution(system,initial_set,verbosity,plot_results);
-  */
+  std::vector<std::thread> workers;
+  for (unsigned int k = 0; k < stages.size(); k++) {
+    if (!stages[k].enabled)
+      continue;
+    cout << k+1 << "/" << stages.size() << ": " << stages[k].name << " started... " << endl << flush;
+    workers.push_back(std::thread([&,k]() {
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      try {
+        Profiler::StageScope scope(stages[k].name);
+        Profiler::Timer timer(profiler,"stage");
+        HybridIOAutomaton system = getAnalysedSystem();
+        HybridBoundedConstraintSet stage_initial_set = getWorkerInitialSet(system,initial_boxes[k]);
+        stages[k].routine(system,stage_initial_set,verbosity,plot_results);
+      } catch (std::exception& ex) {
+        errors[k] = ex.what();
+      }
+      elapsed[k] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }));
+  }
 
+  for (unsigned int i = 0; i < workers.size(); i++)
+    workers[i].join();
 
-  cout << "4/6: Infinite time lower evolution... " << endl << flush;
-  infinite_time_epsilon_lower_evolution(system,initial_set,verbosity,plot_results);
+  // Gathers the outcome of each stage
+  for (unsigned int k = 0; k < stages.size(); k++) {
+    if (!stages[k].enabled)
+      continue;
+    cout << k+1 << "/" << stages.size() << ": " << stages[k].name;
+    if (errors[k].empty())
+      cout << " completed in " << elapsed[k] << " s" << endl;
+    else
+      cout << " failed after " << elapsed[k] << " s: " << errors[k] << endl;
+  }
+}
 
+// Writes the bounds of a box to a reach stream
+void _stream_box(ReachStreamWriter& sink, ReachBoxKind kind, const DiscreteLocation& location, const Box& box) {
+  std::vector<double> lower(box.dimension()), upper(box.dimension());
+  for (unsigned int i = 0; i < box.dimension(); i++) {
+    lower[i] = box[i].lower();
+    upper[i] = box[i].upper();
+  }
+  sink.write(kind,location.name(),lower,upper);
+}
 
-  /*
-  cout << "5/6: Safety verification... " << endl << flush;
-  safety_verification(system,initial_set,verbosity,plot_results);
+// Writes the bounding boxes of the enclosures of a reached set to a reach stream
+void stream_reach(const HybridEvolver::EnclosureListType& reach, ReachStreamWriter& sink) {
+  for (HybridEvolver::EnclosureListType::const_iterator it = reach.begin(); it != reach.end(); ++it)
+    _stream_box(sink,REACH_ENCLOSURE,it->first,it->second.bounding_box());
+}
 
-  cout << "6/6: Parametric safety verification... " << endl << flush;
-  parametric_safety_verification(system,initial_set,verbosity,plot_results);
-  */
+// Writes the cells of a reached set to a reach stream
+void stream_reach(const HybridDenotableSet& reach, ReachStreamWriter& sink) {
+  for (HybridDenotableSet::const_iterator it = reach.begin(); it != reach.end(); ++it)
+    _stream_box(sink,REACH_CELL,it->first,it->second.box());
+}
 
+#ifdef WATERWORLD_HAS_BUDDY
+// An empty binary decision diagram of the cells of the given domain, with room for all its locations
+BddCellSet makeBddCellSet(const HybridBoxes& domain) {
+  const Box& domain_box = domain.locations_begin()->second;
+  std::vector<double> domain_lower(domain_box.dimension()), domain_upper(domain_box.dimension());
+  for (unsigned int i = 0; i < domain_box.dimension(); i++) {
+    domain_lower[i] = domain_box[i].lower();
+    domain_upper[i] = domain_box[i].upper();
+  }
+  unsigned long locations = std::distance(domain.locations_begin(),domain.locations_end());
+  return BddCellSet(std::make_shared<BddCellEncoding>(domain_lower,domain_upper,analysis_settings.bdd_bits,locations));
 }
 
-// Performs finite time evolution.
-HybridEvolver::EnclosureListType _finite_time_evolution(HybridAutomatonInterface& system, HybridBoundedConstraintSet& initial_set, Semantics semantics, int verbosity) {
+// Adds the cells of a grid reached set to a diagram, the rounding telling whether the cells of
+// the set are covered or only the ones inside are kept
+void adjoin_cells(BddCellSet& result, const HybridDenotableSet& reach, BddRounding rounding) {
+  std::vector<double> lower(result.encoding()->dimension()), upper(result.encoding()->dimension());
+  for (HybridDenotableSet::const_iterator it = reach.begin(); it != reach.end(); ++it) {
+    Box box = it->second.box();
+    for (unsigned int i = 0; i < box.dimension(); i++) {
+      lower[i] = box[i].lower();
+      upper[i] = box[i].upper();
+    }
+    result.adjoin(it->first.name(),lower,upper,rounding);
+  }
+}
 
-  // Creates an evolver
-  HybridEvolver evolver(system);
-  evolver.verbosity = verbosity;
-  evolver.settings().set_maximum_step_size(0.6); // The time step size to be used
+// Converts a grid reached set over the given domain into a binary decision diagram of cells
+BddCellSet toBddCellSet(const HybridDenotableSet& reach, const HybridBoxes& domain, BddRounding rounding) {
+  BddCellSet result = makeBddCellSet(domain);
+  adjoin_cells(result,reach,rounding);
+  return result;
+}
+
+// Writes the boxes of a diagram of cells to a reach stream
+void stream_reach(const BddCellSet& reach, ReachStreamWriter& sink) {
+  reach.for_each_box([&sink](const std::string& location, const std::vector<double>& lower, const std::vector<double>& upper) {
+    sink.write(REACH_CELL,location,lower,upper);
+  });
+}
+
+// Records the size of a diagram against the cells it was built from, printing it if verbose
+void profile_diagram(const BddCellSet& diagram, unsigned long cells, int verbosity) {
+  int nodes = diagram.node_count();
+  if (verbosity > 0)
+    cout << "Reached set of " << cells << " cells stored in a diagram of " << nodes << " nodes." << endl;
+  if (profiler.enabled()) {
+    profiler.count(profiler.stage(),"","bdd_cells",cells);
+    profiler.count(profiler.stage(),"","bdd_nodes",nodes);
+  }
+}
+#endif
+
+// Streams a grid reached set, through a diagram of its cells if required and BuDDy is available:
+// the explicit set is then released as soon as it is converted
+void stream_grid_reach(HybridDenotableSet& reach, const HybridBoxes& domain, BddRounding rounding, ReachStreamWriter& sink, int verbosity) {
+#ifdef WATERWORLD_HAS_BUDDY
+  if (analysis_settings.bdd_reach_sets) {
+    unsigned long cells = reach.size();
+    BddCellSet compressed = toBddCellSet(reach,domain,rounding);
+    reach = HybridDenotableSet();
+    profile_diagram(compressed,cells,verbosity);
+    stream_reach(compressed,sink);
+    return;
+  }
+#endif
+  stream_reach(reach,sink);
+}
+
+// Counts the enclosures of a list in each location, under the given metric.
+// Since every step of the evolver adds an enclosure to the reached set,
+// the reach enclosures of a location count the integration steps taken in it.
+void profile_enclosures(const String& stage, const HybridEvolver::EnclosureListType& enclosures, const String& metric) {
+  std::map<String,unsigned long> counts;
+  for (HybridEvolver::EnclosureListType::const_iterator it = enclosures.begin(); it != enclosures.end(); ++it)
+    counts[it->first.name()]++;
+  for (std::map<String,unsigned long>::const_iterator it = counts.begin(); it != counts.end(); ++it)
+    profiler.count(stage,it->first,metric,it->second);
+}
+
+// Splits the name of a composed location into the modes of its components
+std::vector<String> split_location(const String& name) {
+  std::vector<String> modes;
+  size_t start = 0, end;
+  while ((end = name.find(',',start)) != String::npos) {
+    modes.push_back(name.substr(start,end-start));
+    start = end + 1;
+  }
+  modes.push_back(name.substr(start));
+  return modes;
+}
+
+// The code of a location of the composed system, parsed from its name, hence to be taken once for each
+// location by the callers, e.g. when the enclosures of a location are created. The components which are not
+// modes of the plant, e.g. the inputs held by a partial composition, are ignored, hence their modes are not
+// told apart.
+LocationCode getLocationCode(const DiscreteLocation& location, unsigned int tank_number) {
+  LocationCodec codec(tank_number);
+  String name = location.name();
+  LocationCode code;
+  if (!codec.parse(name,code)) {
+    code = codec.initial();
+    std::vector<String> components = split_location(name);
+    for (unsigned int i = 0; i < components.size(); i++) {
+      LocationCode component_code;
+      if (codec.parse(components[i],component_code))
+        code += component_code;
+    }
+  }
+  return code;
+}
+
+// Counts the changes of mode of each component between consecutive enclosures of a reached set,
+// as the transitions leaving each location: e.g. "idle_0>opening_0" stands for an e_open_0 event of
+// valve 0, "opening_0>idle_0" for its forced e_idle_0 event. The counts are approximate: the reached
+// set groups its enclosures by location rather than keeping the order the evolver produced them in,
+// and the orbit does not tell which enclosure each one comes from, hence two consecutive groups need
+// not be joined by a jump, and a location left several times counts once. They tell apart the
+// components which change mode within an orbit, not how many jumps each one takes.
+// The code of a location is parsed only when it differs from the location of the previous enclosure,
+// and the locations are named only when a transition is counted.
+void profile_transitions(const String& stage, const HybridEvolver::EnclosureListType& reach) {
+  LocationCodec codec(analysed_topology.size());
+  bool started = false;
+  const DiscreteLocation* previous_location = 0;
+  LocationCode previous, current;
+  for (HybridEvolver::EnclosureListType::const_iterator it = reach.begin(); it != reach.end(); ++it) {
+    if (started && it->first == *previous_location)
+      continue;
+    current = getLocationCode(it->first,codec.tanks());
+    if (started && current != previous) {
+      String location = codec.name(previous);
+      for (unsigned int k = 0; k < codec.tanks(); k++) {
+        if (codec.valve(previous,k) != codec.valve(current,k))
+          profiler.count(stage,location,"transition " + LocationCodec::valve_name(codec.valve(previous,k),k) + ">" + LocationCodec::valve_name(codec.valve(current,k),k));
+        if (codec.controller(previous,k) != codec.controller(current,k))
+          profiler.count(stage,location,"transition " + LocationCodec::controller_name(codec.controller(previous,k),k) + ">" + LocationCodec::controller_name(codec.controller(current,k),k));
+      }
+    }
+    previous = current;
+    previous_location = &it->first;
+    started = true;
+  }
+}
+
+// Counts the cells of a grid set in each location
+void profile_cells(const String& stage, const HybridDenotableSet& reach, const String& metric) {
+  std::map<String,unsigned long> counts;
+  for (HybridDenotableSet::const_iterator it = reach.begin(); it != reach.end(); ++it)
+    counts[it->first.name()]++;
+  for (std::map<String,unsigned long>::const_iterator it = counts.begin(); it != counts.end(); ++it)
+    profiler.count(stage,it->first,metric,it->second);
+}
+
+// The modes of the valves in a location of the composed system, from the names of the valve locations
+std::vector<ValveMode> getValveModes(const DiscreteLocation& location, unsigned int tank_number) {
+  LocationCodec codec(tank_number);
+  LocationCode code = getLocationCode(location,tank_number);
+  std::vector<ValveMode> modes(tank_number);
+  for (unsigned int k = 0; k < tank_number; k++)
+    modes[k] = codec.valve(code,k);
+  return modes;
+}
+
+// Encloses the derivatives over the cells of a grid set, with one batch of cells per location.
+// The batches hold the water levels before the valve levels, as the kernel wants them, while
+// the cells have the variables of the system in alphabetical order (see getTankVariableIndices).
+std::map< DiscreteLocation, std::pair<BoxBatch,BoxBatch> > cell_derivatives(const HybridDenotableSet& cells, const PlantTopology& topology) {
+
+  unsigned int n = topology.size();
+  std::map< DiscreteLocation, std::vector<Box> > boxes;
+  for (HybridDenotableSet::const_iterator it = cells.begin(); it != cells.end(); ++it)
+    boxes[it->first].push_back(it->second.box());
+
+  DynamicsKernel kernel(topology);
+  TankVariableIndices indices = getTankVariableIndices(n);
+  std::map< DiscreteLocation, std::pair<BoxBatch,BoxBatch> > result;
+  for (std::map< DiscreteLocation, std::vector<Box> >::const_iterator it = boxes.begin(); it != boxes.end(); ++it) {
+    const std::vector<Box>& location_boxes = it->second;
+    BoxBatch batch(2*n,location_boxes.size()), derivatives(2*n,location_boxes.size());
+    for (unsigned int j = 0; j < location_boxes.size(); j++) {
+      for (unsigned int k = 0; k < n; k++) {
+        batch.lower(k)[j] = location_boxes[j][indices.waterlevel[k]].lower();
+        batch.upper(k)[j] = location_boxes[j][indices.waterlevel[k]].upper();
+        batch.lower(n+k)[j] = location_boxes[j][indices.valvelevel[k]].lower();
+        batch.upper(n+k)[j] = location_boxes[j][indices.valvelevel[k]].upper();
+      }
+    }
+    kernel.evaluate(getValveModes(it->first,n),batch,derivatives);
+    result.insert(std::make_pair(it->first,std::make_pair(batch,derivatives)));
+  }
+  return result;
+}
+
+// The signature of the state of each tank, with its valve and controller, within a box of the location of the given code
+std::vector<std::string> getTankSignatures(const LocationCode& code, const Box& box, unsigned int tank_number) {
+  LocationCodec codec(tank_number);
+  TankVariableIndices indices = getTankVariableIndices(tank_number);
+  std::vector<std::string> signatures(tank_number);
+  for (unsigned int k = 0; k < tank_number; k++) {
+    std::ostringstream signature;
+    signature << std::setprecision(17) << codec.valve(code,k);
+    signature << (codec.controller(code,k) == CONTROLLER_FALLING ? "F" : "R");
+    const Interval& valvelevel = box[indices.valvelevel[k]];
+    const Interval& waterlevel = box[indices.waterlevel[k]];
+    signature << valvelevel.lower() << ":" << valvelevel.upper() << ":" << waterlevel.lower() << ":" << waterlevel.upper();
+    signatures[k] = signature.str();
+  }
+  return signatures;
+}
+
+// The key of the canonical representative of a box of the location of the given code: two boxes have the same
+// key iff one is the image of the other by swapping identical branches of the plant
+String getCanonicalKey(const PlantSymmetry& symmetry, const LocationCode& code, const Box& box) {
+  std::vector<std::string> signatures = getTankSignatures(code,box,analysed_topology.size());
+  std::vector<unsigned int> permutation = symmetry.canonical_permutation(signatures);
+  String key;
+  for (unsigned int k = 0; k < permutation.size(); k++)
+    key += signatures[permutation[k]] + ";";
+  return key;
+}
+
+// Whether the safe ranges are the same for all the tanks and all the locations, which makes the
+// safety specification invariant under any swap of the branches
+bool isSafetySymmetric() {
+  if (!analysis_settings.location_safe_waterlevels.empty())
+    return false;
+  for (unsigned int k = 1; k < analysis_settings.safe_waterlevels.size(); k++) {
+    if (analysis_settings.safe_waterlevels[k].lower() != analysis_settings.safe_waterlevels[0].lower()
+        || analysis_settings.safe_waterlevels[k].upper() != analysis_settings.safe_waterlevels[0].upper())
+      return false;
+  }
+  return analysis_settings.safe_waterlevels.empty() || analysis_settings.safe_waterlevels.size() == analysed_topology.size();
+}
+
+// Keeps one box of the initial set for each class of boxes which are images of one another by
+// swapping identical branches of the plant. The reach of the dropped boxes is the image of the reach
+// of the kept ones, hence a symmetric safety specification holds for the whole initial set iff it holds
+// for the reduced one. The boxes of the initial set are taken from its domain, hence it must be made of boxes.
+// Only the initial boxes are reduced, not the cells reached from them, since the grid reach is computed by the
+// analyser: the reduction saves work only for initial sets spanning symmetric locations or boxes, and none for
+// an initial set of a single box. The reached starts are reduced by the on-the-fly safety check alone.
+HybridBoundedConstraintSet getSymmetryReducedInitialSet(HybridAutomatonInterface& system, HybridBoundedConstraintSet& initial_set) {
+
+  PlantSymmetry symmetry(analysed_topology);
+  if (!symmetry.is_symmetric() || !isSafetySymmetric())
+    return initial_set;
+
+  HybridBoundedConstraintSet reduced_set(system.state_space());
+  std::set<String> keys;
+  unsigned int dropped = 0;
+  HybridBoxes initial_set_domain = initial_set.domain();
+  for (HybridBoxes::const_iterator it = initial_set_domain.locations_begin(); it != initial_set_domain.locations_end(); ++it) {
+    if (it->second.empty())
+      continue;
+    if (keys.insert(getCanonicalKey(symmetry,getLocationCode(it->first,analysed_topology.size()),it->second)).second)
+      reduced_set[it->first] = it->second;
+    else
+      dropped++;
+  }
+  if (dropped > 0)
+    cout << "Symmetry reduction: " << dropped << " initial boxes are images of other ones." << endl;
+  return reduced_set;
+}
+
+// Evolves a batch of initial enclosures, spreading them over a pool of workers, each one with its own evolver.
+// The first worker evolves on the given system, which the caller does not use while waiting for the pool, the
+// others on their own systems built by getAnalysedSystem(), hence the given system must be the analysed one.
+// The reached sets of the orbits are kept in the order of the initial enclosures and merged at the end.
+// If a sink is given, each reached set is instead written to it as soon as its orbit is computed, and
+// the returned list is empty: the orbit of each worker is still held whole until it is written. An exception thrown by an orbit is captured by the pool and rethrown here.
+HybridEvolver::EnclosureListType _batch_finite_time_evolution(HybridAutomatonInterface& system, const HybridEvolver::EnclosureListType& initial_enclosures,
+    const HybridTime& evol_limits, Semantics semantics, int verbosity, unsigned int workers, ReachStreamWriter* sink = NULL) {
+
+  std::vector<HybridEvolver::EnclosureType> enclosures(initial_enclosures.begin(),initial_enclosures.end());
+  std::vector<HybridEvolver::EnclosureListType> reaches(enclosures.size());
+
+  WorkStealingPool pool(std::min<unsigned int>(workers,enclosures.size()));
+
+  // The per-worker systems and evolvers, created by the workers themselves
+  std::vector< std::unique_ptr<HybridIOAutomaton> > systems(pool.size());
+  std::vector< std::unique_ptr<HybridEvolver> > evolvers(pool.size());
+
+  // The workers record their measures for the stage of the caller
+  String stage = profiler.stage();
+
+  for (unsigned int i = 0; i < enclosures.size(); i++) {
+    pool.submit([&,i](WorkStealingPool& pool, unsigned int worker) {
+      if (!evolvers[worker]) {
+        if (worker > 0)
+          systems[worker].reset(new HybridIOAutomaton(getAnalysedSystem()));
+        evolvers[worker].reset(new HybridEvolver(worker > 0 ? *systems[worker] : system));
+        evolvers[worker]->verbosity = verbosity;
+        evolvers[worker]->settings().set_maximum_step_size(analysis_settings.maximum_step_size); // The time step size to be used
+      }
+      Profiler::Timer timer(profiler,stage,"orbit");
+      HybridEvolver::OrbitType orbit = evolvers[worker]->orbit(enclosures[i], evol_limits, semantics);
+      if (profiler.enabled()) {
+        profile_enclosures(stage,orbit.reach(),"reach_enclosures");
+        profile_enclosures(stage,orbit.final(),"final_enclosures");
+        profile_transitions(stage,orbit.reach());
+      }
+      if (sink)
+        stream_reach(orbit.reach(),*sink);
+      else
+        reaches[i] = orbit.reach();
+    });
+  }
+  pool.run();
+
+  // Merges all the reached sets
+  HybridEvolver::EnclosureListType result;
+  for (unsigned int i = 0; i < reaches.size(); i++)
+    result.adjoin(reaches[i]);
+
+  return result;
+}
+
+// Performs finite time evolution.
+HybridEvolver::EnclosureListType _finite_time_evolution(HybridAutomatonInterface& system, HybridBoundedConstraintSet& initial_set, Semantics semantics, int verbosity, ReachStreamWriter* sink) {
 
   // Creates a list of initial enclosures from the initial set.
   // This operation is only necessary since we provided an initial set expressed as a constraint set
@@ -90,27 +690,31 @@ HybridEvolver::EnclosureListType _finite_time_evolution(HybridAutomatonInterface
   }
 
   // The maximum evolution time, expressed as a continuous time limit along with a maximum number of events
-  // The evolution stops for each trajectory as soon as one of the two limits are reached
+  // The evolution stops for each trajectory as soon as one of the two limits are reached.
+  // The fixpoint of on_the_fly_safety_check() is not taken here: an enclosure does not tell how many events
+  // led to it, hence a start could not be dropped for one of fewer events, and a lower reach is no cover anyway
   HybridTime evol_limits(8.0,3);
 
-  // Performs the evolution, saving only the reached set of the orbit
-  HybridEvolver::EnclosureListType result;
-  for (HybridEvolver::EnclosureListType::const_iterator it = initial_enclosures.begin(); it != initial_enclosures.end(); ++it) {
-    HybridEvolver::OrbitType orbit = evolver.orbit(*it, evol_limits, semantics);
-    result.adjoin(orbit.reach());
-  }
-
-  return result;
+  // Performs the evolution of all the initial enclosures, saving only the reached set of the orbits
+  return _batch_finite_time_evolution(system, initial_enclosures, evol_limits, semantics, verbosity, std::thread::hardware_concurrency(), sink);
 }
 
 // Performs finite time upper evolution
 void finite_time_upper_evolution(HybridAutomatonInterface& system, HybridBoundedConstraintSet& initial_set, int verbosity, bool plot_results) {
 
+  // Streams the reached set while it is computed, if required
+  if (!analysis_settings.stream_prefix.empty()) {
+    ReachStreamWriter sink(analysis_settings.stream_prefix + "upper_reach.reach", 2*getTankNumber(initial_set));
+    _finite_time_evolution(system, initial_set, UPPER_SEMANTICS, verbosity, &sink);
+    return;
+  }
+
   // Performs the evolution, saving only the reached set of the orbit
   HybridEvolver::EnclosureListType reach = _finite_time_evolution(system, initial_set, UPPER_SEMANTICS, verbosity);
 
   // Plots the reached set specifically
   if (plot_results) {
+    std::lock_guard<std::mutex> lock(plot_mutex);
     PlotHelper plotter(system);
     plotter.plot(reach,"upper_reach");
   }
@@ -119,65 +723,899 @@ void finite_time_upper_evolution(HybridAutomatonInterface& system, HybridBounded
 // Performs finite time lower evolution.
 void finite_time_lower_evolution(HybridAutomatonInterface& system, HybridBoundedConstraintSet& initial_set, int verbosity, bool plot_results) {
 
+  // Streams the reached set while it is computed, if required
+  if (!analysis_settings.stream_prefix.empty()) {
+    ReachStreamWriter sink(analysis_settings.stream_prefix + "lower_reach.reach", 2*getTankNumber(initial_set));
+    _finite_time_evolution(system, initial_set, LOWER_SEMANTICS, verbosity, &sink);
+    return;
+  }
+
   // Performs the evolution, saving only the reached set of the orbit
   HybridEvolver::EnclosureListType reach = _finite_time_evolution(system, initial_set, LOWER_SEMANTICS, verbosity);
 
   // Plots the reached set specifically
   if (plot_results) {
+    std::lock_guard<std::mutex> lock(plot_mutex);
     PlotHelper plotter(system);
     plotter.plot(reach,"lower_reach");
   }
 }
 
-// Performs infinite time outer evolution
-void infinite_time_outer_evolution(HybridAutomatonInterface& system, HybridBoundedConstraintSet& initial_set, int verbosity, bool plot_results) {
+// A bound on the events of a window of the given duration which no trajectory can reach, so that the evolution
+// of a window always stops at its end, never at the event limit: the events of a tank alternate a command to its
+// valve (e_open or e_close), which the valve accepts only when idle, and the forced e_idle ending the movement.
+// After an e_idle the valve is fully open or closed, hence each movement but the first of a window lasts the
+// whole opening time. The bound is doubled, so that it still holds for the enclosures whose valve level is so
+// wide that they end a movement earlier, as long as each movement lasts at least half the opening time.
+int getWindowEventBound(unsigned int tank_number, double duration) {
+  double movements = std::ceil(duration / analysed_topology.opening_time) + 2;
+  return 2 * (int)(tank_number * 2 * movements);
+}
 
-  // Creates the domain, necessary to guarantee termination for infinite-time evolution
-  // HybridBoxes domain(system.state_space(),Box(2,0.0,1.0,4.5,9.0));
-  HybridBoxes domain(system.state_space(),Box(6,0.0,1.0,0.0,1.0,0.0,1.0,4.5,9.0,4.5,9.0,4.5,9.0));
+// The smallest interval containing both the given ones
+Interval interval_hull(const Interval& first, const Interval& second) {
+  return Interval(std::min(first.lower(),second.lower()),std::max(first.upper(),second.upper()));
+}
+
+// A reached set saved by an earlier run, along with what it was computed for
+struct WarmStart {
+  // The hash of the structure of the plant, which tells whether the cells are over the same variables and locations
+  uint64_t structure_hash;
+  // The description of the plant, with its parameter values
+  String plant;
+  int accuracy;
+  // The initial set, one line per location
+  String initial_set;
+  // The saved cells
+  std::vector<ReachBox> cells;
+  // The epsilon of an epsilon-lower reach, empty for an outer reach
+  std::map<String, std::vector<double> > epsilon;
+};
+
+// Describes the initial set, in order to tell whether a saved reach was computed from the same one
+String describe_initial_set(HybridBoundedConstraintSet& initial_set) {
+  std::ostringstream description;
+  description << std::setprecision(17);
+  HybridBoxes initial_set_domain = initial_set.domain();
+  for (HybridBoxes::const_iterator it = initial_set_domain.locations_begin(); it != initial_set_domain.locations_end(); ++it) {
+    if (it->second.empty())
+      continue;
+    description << it->first.name();
+    for (unsigned int i = 0; i < it->second.dimension(); i++)
+      description << " " << it->second[i].lower() << " " << it->second[i].upper();
+    description << ";";
+  }
+  return description.str();
+}
+
+// Saves a reached set as <prefix><name>.warm, a reach stream of its cells, and <prefix><name>.warm.txt,
+// which holds the hash of the structure of the plant, its description, the accuracy, the initial set and
+// the epsilon, if any
+void save_warm_start(const String& name, HybridBoundedConstraintSet& initial_set, const HybridDenotableSet& reach,
+    int accuracy, const HybridFloatVector* epsilon = NULL) {
+
+  String filename = analysis_settings.warm_start_prefix + name + ".warm";
+  {
+    ReachStreamWriter sink(filename,2*getTankNumber(initial_set));
+    stream_reach(reach,sink);
+  }
+
+  std::ofstream metadata((filename + ".txt").c_str());
+  metadata << std::setprecision(17);
+  metadata << "structure " << structure_hash(analysed_topology) << "\n";
+  metadata << "plant " << describe(analysed_topology) << "\n";
+  metadata << "accuracy " << accuracy << "\n";
+  metadata << "initial " << describe_initial_set(initial_set) << "\n";
+  if (epsilon != NULL) {
+    for (HybridFloatVector::const_iterator it = epsilon->begin(); it != epsilon->end(); ++it) {
+      metadata << "epsilon " << it->first.name();
+      for (unsigned int i = 0; i < it->second.size(); i++)
+        metadata << " " << it->second[i];
+      metadata << "\n";
+    }
+  }
+}
+
+// Loads a reached set saved by save_warm_start, returning false if there is none or if it cannot be used:
+// when it was saved for a plant of another structure, as told by the hash, when its cells do not have the given
+// dimension, or when its reach stream is corrupted, in which case the reason is printed. The parameter values
+// of the plant may differ: the callers tell whether the cells are still of use
+bool load_warm_start(const String& name, unsigned int dimension, WarmStart& saved) {
 
-  // The accuracy of computation in terms of discretization; the larger, the smaller the grid cells used
-  int accuracy = 1;
+  String filename = analysis_settings.warm_start_prefix + name + ".warm";
+  std::ifstream metadata((filename + ".txt").c_str());
+  if (!metadata)
+    return false;
+
+  saved.structure_hash = 0;
+  saved.accuracy = 0;
+  String line;
+  while (std::getline(metadata,line)) {
+    std::istringstream fields(line);
+    String key;
+    fields >> key;
+    if (key == "structure")
+      fields >> saved.structure_hash;
+    else if (key == "plant")
+      std::getline(fields >> std::ws,saved.plant);
+    else if (key == "accuracy")
+      fields >> saved.accuracy;
+    else if (key == "initial")
+      std::getline(fields >> std::ws,saved.initial_set);
+    else if (key == "epsilon") {
+      String location;
+      double value;
+      fields >> location;
+      while (fields >> value)
+        saved.epsilon[location].push_back(value);
+    }
+  }
+
+  if (saved.structure_hash != structure_hash(analysed_topology)) {
+    cout << "Warm start '" << filename << "' ignored, since it was saved for a plant of another structure." << endl;
+    return false;
+  }
+
+  try {
+    ReachStreamReader stream(filename);
+    if (stream.dimension() != dimension) {
+      cout << "Warm start '" << filename << "' ignored, since its cells have dimension " << stream.dimension()
+           << " instead of " << dimension << "." << endl;
+      return false;
+    }
+    ReachBox box;
+    while (stream.next(box))
+      saved.cells.push_back(box);
+  } catch (std::exception& ex) {
+    cout << "Warm start '" << filename << "' ignored: " << ex.what() << endl;
+    saved.cells.clear();
+    return false;
+  }
+  return true;
+}
+
+// The union of the cells of a saved reach, kept as the cells of the finest grid they are made of in each location,
+// telling whether a box lies within the union. The cells must be the ones of a grid set, as saved by save_warm_start.
+class CellCover {
+
+    std::vector<double> _origin;
+    std::vector<double> _width;
+    std::map< String, std::set< std::vector<long> > > _cells;
+
+    // The boxes overlapping more cells than this are taken as not covered, rather than looked up cell by cell
+    static const unsigned long MAXIMUM_LOOKUPS = 1 << 20;
+
+    // Calls the function on each index between the lower and the upper one, included, while it returns true;
+    // returns whether it always did
+    static bool _for_each_index(const std::vector<long>& lower, const std::vector<long>& upper, const std::function<bool(const std::vector<long>&)>& function) {
+      std::vector<long> index = lower;
+      while (true) {
+        if (!function(index))
+          return false;
+        unsigned int i = 0;
+        while (i < index.size() && index[i] == upper[i]) {
+          index[i] = lower[i];
+          i++;
+        }
+        if (i == index.size())
+          return true;
+        index[i]++;
+      }
+    }
+
+  public:
+
+    CellCover(const std::vector<ReachBox>& cells) {
+      if (cells.empty())
+        return;
+      unsigned int dimension = cells[0].lower.size();
+      _origin = cells[0].lower;
+      _width.assign(dimension,0.0);
+      for (unsigned int c = 0; c < cells.size(); c++) {
+        for (unsigned int i = 0; i < dimension; i++) {
+          double width = cells[c].upper[i] - cells[c].lower[i];
+          if (width > 0.0 && (_width[i] == 0.0 || width < _width[i]))
+            _width[i] = width;
+        }
+      }
+      // The cells are aligned on the finest grid, hence their bounds are whole numbers of its cells from the origin
+      for (unsigned int c = 0; c < cells.size(); c++) {
+        std::vector<long> lower(dimension), upper(dimension);
+        for (unsigned int i = 0; i < dimension; i++) {
+          lower[i] = (_width[i] > 0.0 ? std::lround((cells[c].lower[i] - _origin[i]) / _width[i]) : 0);
+          upper[i] = (_width[i] > 0.0 ? std::max(lower[i],std::lround((cells[c].upper[i] - _origin[i]) / _width[i]) - 1) : 0);
+        }
+        std::set< std::vector<long> >& location_cells = _cells[cells[c].location];
+        _for_each_index(lower,upper,[&location_cells](const std::vector<long>& index) {
+          location_cells.insert(index);
+          return true;
+        });
+      }
+    }
+
+    // Whether the box lies within the cells of the location. The indices of the cells it overlaps are widened by a
+    // small tolerance, so that the rounding of the bounds can only make the check fail, never pass.
+    bool covers(const String& location, const Box& box) const {
+      std::map< String, std::set< std::vector<long> > >::const_iterator it = _cells.find(location);
+      if (it == _cells.end())
+        return false;
+      const double tolerance = 1e-9;
+      std::vector<long> lower(box.dimension()), upper(box.dimension());
+      double lookups = 1.0;
+      for (unsigned int i = 0; i < box.dimension(); i++) {
+        if (_width[i] == 0.0) {
+          if (box[i].lower() != _origin[i] || box[i].upper() != _origin[i])
+            return false;
+          lower[i] = upper[i] = 0;
+          continue;
+        }
+        lower[i] = (long)std::floor((box[i].lower() - _origin[i]) / _width[i] - tolerance);
+        upper[i] = std::max(lower[i],(long)std::ceil((box[i].upper() - _origin[i]) / _width[i] + tolerance) - 1);
+        lookups *= upper[i] - lower[i] + 1;
+      }
+      if (lookups > MAXIMUM_LOOKUPS)
+        return false;
+      const std::set< std::vector<long> >& location_cells = it->second;
+      return _for_each_index(lower,upper,[&location_cells](const std::vector<long>& index) {
+        return location_cells.count(index) > 0;
+      });
+    }
+};
+
+// The frontier of a saved outer reach under the plant under analysis, as the hull of its boxes in each location: the
+// cells are evolved over a window, and the reach enclosures which are not within their union are part of the frontier,
+// along with the initial boxes which are not within it. A trajectory from the initial set starts within the cells or
+// in the frontier, and if it leaves the cells, it does so within the window following a point of a cell, hence in the
+// frontier. Thus the union of the cells with the outer reach of the frontier contains the reach of the initial set,
+// even when the cells were computed for other parameter values. The frontier is empty when the cells contain the
+// initial set and are invariant under the plant. The boxes of the initial set are taken from its domain.
+std::map<DiscreteLocation,Box> warm_start_frontier(HybridAutomatonInterface& system, HybridBoundedConstraintSet& initial_set,
+    const WarmStart& saved, int verbosity) {
+
+  unsigned int n = getTankNumber(initial_set);
+  CellCover cover(saved.cells);
+  std::map<DiscreteLocation,Box> frontier;
+  std::function<void(const DiscreteLocation&,const Box&)> add = [&frontier](const DiscreteLocation& location, const Box& box) {
+    std::map<DiscreteLocation,Box>::iterator it = frontier.find(location);
+    if (it == frontier.end()) {
+      frontier.insert(std::make_pair(location,box));
+    } else {
+      for (unsigned int i = 0; i < box.dimension(); i++)
+        it->second[i] = interval_hull(it->second[i],box[i]);
+    }
+  };
+
+  HybridBoxes initial_set_domain = initial_set.domain();
+  for (HybridBoxes::const_iterator it = initial_set_domain.locations_begin(); it != initial_set_domain.locations_end(); ++it) {
+    if (!it->second.empty() && !cover.covers(it->first.name(),it->second))
+      add(it->first,it->second);
+  }
+
+  HybridEvolver::EnclosureListType cells;
+  for (unsigned int c = 0; c < saved.cells.size(); c++) {
+    Box box(saved.cells[c].lower.size());
+    for (unsigned int i = 0; i < box.dimension(); i++)
+      box[i] = Interval(saved.cells[c].lower[i],saved.cells[c].upper[i]);
+    cells.adjoin(HybridEvolver::EnclosureType(DiscreteLocation(saved.cells[c].location),box));
+  }
+  HybridTime window(analysis_settings.warm_start_window,getWindowEventBound(n,analysis_settings.warm_start_window));
+  HybridEvolver::EnclosureListType reach = _batch_finite_time_evolution(system, cells, window, UPPER_SEMANTICS, verbosity, std::thread::hardware_concurrency());
+  for (HybridEvolver::EnclosureListType::const_iterator it = reach.begin(); it != reach.end(); ++it) {
+    Box box = it->second.bounding_box();
+    if (!cover.covers(it->first.name(),box))
+      add(it->first,box);
+  }
+  return frontier;
+}
+
+// Performs the outer reach over the analysis domain, on the grid of the given accuracy
+HybridDenotableSet _outer_chain_reach(HybridAutomatonInterface& system, HybridBoundedConstraintSet& initial_set, int verbosity, int accuracy) {
+
+  // Creates the domain, necessary to guarantee termination for infinite-time evolution
+  HybridBoxes domain = getAnalysisDomain(system,initial_set);
 
   // Creates an analyser with the required arguments
   HybridReachabilityAnalyser analyser(system,domain,accuracy);
   analyser.verbosity = verbosity;
 
   // Performs the outer reach
+  Profiler::Timer timer(profiler,"outer_chain_reach");
   HybridDenotableSet reach = analyser.outer_chain_reach(initial_set);
+  if (profiler.enabled())
+    profile_cells(profiler.stage(),reach,"grid_cells");
+  return reach;
+}
+
+#ifdef WATERWORLD_HAS_BUDDY
+// Performs the outer reach one location of the initial set at a time, adjoining the cells of each piece to a
+// diagram and releasing its grid set before the next piece: the outer reach of a union is the union of the outer
+// reaches, hence only the grid set of the largest piece and the diagram are held at once. The pieces are taken
+// from the domain of the initial set, hence it must be made of boxes. An initial set of a single location gives
+// a single piece, whose grid set is held whole as without the diagram.
+BddCellSet _piecewise_outer_chain_reach(HybridAutomatonInterface& system, HybridBoundedConstraintSet& initial_set, int verbosity, int accuracy) {
+
+  BddCellSet result = makeBddCellSet(getAnalysisDomain(system,initial_set));
+  unsigned long cells = 0;
+  HybridBoxes initial_set_domain = initial_set.domain();
+  for (HybridBoxes::const_iterator it = initial_set_domain.locations_begin(); it != initial_set_domain.locations_end(); ++it) {
+    if (it->second.empty())
+      continue;
+    HybridBoundedConstraintSet piece(system.state_space());
+    piece[it->first] = it->second;
+    HybridDenotableSet reach = _outer_chain_reach(system, piece, verbosity, accuracy);
+    cells += reach.size();
+    adjoin_cells(result,reach,BDD_OUTER);
+  }
+  profile_diagram(result,cells,verbosity);
+  return result;
+}
+#endif
+
+// Performs infinite time outer evolution
+void infinite_time_outer_evolution(HybridAutomatonInterface& system, HybridBoundedConstraintSet& initial_set, int verbosity, bool plot_results) {
+
+#ifdef WATERWORLD_HAS_BUDDY
+  // Keeps only the diagram of the reach while it is computed, if it is streamed and not saved
+  if (analysis_settings.bdd_reach_sets && !analysis_settings.stream_prefix.empty() && analysis_settings.warm_start_prefix.empty()) {
+    BddCellSet reach = _piecewise_outer_chain_reach(system, initial_set, verbosity, analysis_settings.outer_accuracy);
+    ReachStreamWriter sink(analysis_settings.stream_prefix + "outer.reach", 2*getTankNumber(initial_set));
+    stream_reach(reach,sink);
+    return;
+  }
+#endif
+
+  // Starts from the reach of an earlier run, if any, when streaming: its cells are kept, and only the frontier of
+  // their reach under the plant under analysis is explored, on the grid of the required accuracy. The result mixes
+  // the saved cells with a new grid set, hence it is streamed and not plotted; it is not saved either, so that the
+  // saved cells never grow. A reach saved on a coarser grid is not used, since the result would be no finer than it
+  WarmStart saved;
+  if (!analysis_settings.warm_start_prefix.empty() && !analysis_settings.stream_prefix.empty()
+      && load_warm_start("outer",2*getTankNumber(initial_set),saved)) {
+    if (saved.accuracy >= analysis_settings.outer_accuracy) {
+      std::map<DiscreteLocation,Box> frontier = warm_start_frontier(system, initial_set, saved, verbosity);
+      cout << "Outer reach of an earlier run reused, with " << saved.cells.size() << " cells and a frontier in "
+           << frontier.size() << " locations." << endl;
+      ReachStreamWriter sink(analysis_settings.stream_prefix + "outer.reach", 2*getTankNumber(initial_set));
+      for (unsigned int c = 0; c < saved.cells.size(); c++)
+        sink.write(REACH_CELL,saved.cells[c].location,saved.cells[c].lower,saved.cells[c].upper);
+      if (!frontier.empty()) {
+        HybridBoundedConstraintSet frontier_set(system.state_space());
+        for (std::map<DiscreteLocation,Box>::const_iterator it = frontier.begin(); it != frontier.end(); ++it)
+          frontier_set[it->first] = it->second;
+        HybridDenotableSet reach = _outer_chain_reach(system, frontier_set, verbosity, analysis_settings.outer_accuracy);
+        stream_grid_reach(reach,getAnalysisDomain(system,initial_set),BDD_OUTER,sink,verbosity);
+      }
+      return;
+    }
+    cout << "Outer reach of an earlier run ignored, since it was computed on a coarser grid." << endl;
+  }
+
+  // Performs the outer reach, saving it if required
+  HybridDenotableSet reach = _outer_chain_reach(system, initial_set, verbosity, analysis_settings.outer_accuracy);
+  if (!analysis_settings.warm_start_prefix.empty())
+    save_warm_start("outer",initial_set,reach,analysis_settings.outer_accuracy);
+
+  // Streams the reached region instead of plotting it, if required
+  if (!analysis_settings.stream_prefix.empty()) {
+    ReachStreamWriter sink(analysis_settings.stream_prefix + "outer.reach", 2*getTankNumber(initial_set));
+    stream_grid_reach(reach,getAnalysisDomain(system,initial_set),BDD_OUTER,sink,verbosity);
+    return;
+  }
 
   // Plots the reached region
   if (plot_results) {
+    std::lock_guard<std::mutex> lock(plot_mutex);
     PlotHelper plotter(system);
-    plotter.plot(reach,"outer",accuracy);
+    plotter.plot(reach,"outer",analysis_settings.outer_accuracy);
   }
 }
 
-// Performs infinite time epsilon-lower evolution
-void infinite_time_epsilon_lower_evolution(HybridAutomatonInterface& system, HybridBoundedConstraintSet& initial_set, int verbosity, bool plot_results) {
+// Performs the epsilon-lower reach over the analysis domain, on the grid of the given accuracy, also outputting the obtained epsilon
+std::pair<HybridDenotableSet,HybridFloatVector> _epsilon_lower_chain_reach(HybridAutomatonInterface& system, HybridBoundedConstraintSet& initial_set, int verbosity, int accuracy) {
 
   // Creates the domain, necessary to guarantee termination for infinite-time evolution
-  // HybridBoxes domain(system.state_space(),Box(2,0.0,1.0,4.5,9.0));
-  HybridBoxes domain(system.state_space(),Box(6,0.0,1.0,0.0,1.0,0.0,1.0,4.5,9.0,4.5,9.0,4.5,9.0));
-
-  // The accuracy of computation in terms of discretization; the larger, the smaller the grid cells used
-  // int accuracy = 5;
-  int accuracy = 2;
+  HybridBoxes domain = getAnalysisDomain(system,initial_set);
 
   // Creates an analyser with the required arguments
   HybridReachabilityAnalyser analyser(system,domain,accuracy);
   analyser.verbosity = verbosity;
 
+  // Performs the lower reach
+  Profiler::Timer timer(profiler,"epsilon_lower_chain_reach");
+  std::pair<HybridDenotableSet,HybridFloatVector> result = analyser.epsilon_lower_chain_reach(initial_set);
+  if (profiler.enabled())
+    profile_cells(profiler.stage(),result.first,"grid_cells");
+  return result;
+}
+
+// Performs infinite time epsilon-lower evolution
+void infinite_time_epsilon_lower_evolution(HybridAutomatonInterface& system, HybridBoundedConstraintSet& initial_set, int verbosity, bool plot_results) {
+
+  // A lower reach cannot be seeded with cells which might not be reachable: the cells of another plant may not be,
+  // and the ones of the same plant are reachable only within their own epsilon, which the analyser would not add to
+  // the one of the new reach. Hence an earlier one is only reused as a whole, if it was computed for the same plant,
+  // parameter values and initial set, on a grid at least as fine as the required one; a refinement to a finer grid
+  // is computed anew. Since it is kept as a reach stream, this is possible when streaming, without plotting. The
+  // whole stream is read and checked by load_warm_start before it is copied
+  WarmStart saved;
+  if (!analysis_settings.warm_start_prefix.empty() && !analysis_settings.stream_prefix.empty()
+      && load_warm_start("lower",2*getTankNumber(initial_set),saved) && saved.plant == describe(analysed_topology)
+      && saved.accuracy >= analysis_settings.lower_accuracy && saved.initial_set == describe_initial_set(initial_set)) {
+    std::ifstream source((analysis_settings.warm_start_prefix + "lower.warm").c_str(), std::ios::binary);
+    std::ofstream destination((analysis_settings.stream_prefix + "lower.reach").c_str(), std::ios::binary);
+    destination << source.rdbuf();
+    cout << "Epsilon-lower reach of an earlier run reused, with epsilon:" << endl;
+    for (std::map<String, std::vector<double> >::const_iterator it = saved.epsilon.begin(); it != saved.epsilon.end(); ++it) {
+      cout << "  " << it->first << ":";
+      for (unsigned int i = 0; i < it->second.size(); i++)
+        cout << " " << it->second[i];
+      cout << endl;
+    }
+    return;
+  }
+
   // Performs the lower reach, also outputting the obtained epsilon
   HybridDenotableSet reach;
   HybridFloatVector epsilon;
 
-  make_lpair<HybridDenotableSet,HybridFloatVector>(reach,epsilon) = analyser.epsilon_lower_chain_reach(initial_set);
+  make_lpair<HybridDenotableSet,HybridFloatVector>(reach,epsilon) = _epsilon_lower_chain_reach(system, initial_set, verbosity, analysis_settings.lower_accuracy);
+  if (!analysis_settings.warm_start_prefix.empty())
+    save_warm_start("lower",initial_set,reach,analysis_settings.lower_accuracy,&epsilon);
+
+  // Streams the reached region instead of plotting it, if required
+  if (!analysis_settings.stream_prefix.empty()) {
+    ReachStreamWriter sink(analysis_settings.stream_prefix + "lower.reach", 2*getTankNumber(initial_set));
+    stream_grid_reach(reach,getAnalysisDomain(system,initial_set),BDD_INNER,sink,verbosity);
+    return;
+  }
 
   // Plots the reached region
   if (plot_results) {
+    std::lock_guard<std::mutex> lock(plot_mutex);
     PlotHelper plotter(system);
-    plotter.plot(reach,"lower",accuracy);
+    plotter.plot(reach,"lower",analysis_settings.lower_accuracy);
+  }
+}
+
+// Counts the cells of a grid set which still call for a finer grid: those close to a bound of the safe
+// water levels, with the water level possibly moving towards it. A cell is close to a value when it is
+// within half its width from it. The derivatives are enclosed by the dynamics kernel. The thresholds of
+// the controllers are not taken into account: the plant crosses them at every cycle, hence some cells
+// would be close to them at any accuracy, and the refinement would never stop before the maximum one.
+unsigned long count_critical_cells(const HybridDenotableSet& reach, const PlantTopology& topology) {
+
+  unsigned int n = topology.size();
+  unsigned long critical = 0;
+  SafeWaterLevelTable safe_levels(n);
+  std::map< DiscreteLocation, std::pair<BoxBatch,BoxBatch> > batches = cell_derivatives(reach,topology);
+  for (std::map< DiscreteLocation, std::pair<BoxBatch,BoxBatch> >::const_iterator it = batches.begin(); it != batches.end(); ++it) {
+    const BoxBatch& cells = it->second.first;
+    const BoxBatch& derivatives = it->second.second;
+    const std::vector<Interval>& safe = safe_levels[getLocationCode(it->first,n)];
+    unsigned long location_critical = 0;
+    for (unsigned int j = 0; j < cells.size(); j++) {
+      for (unsigned int k = 0; k < n; k++) {
+        double lower = cells.lower(k)[j], upper = cells.upper(k)[j];
+        double margin = (upper - lower) / 2;
+        bool near_safe_maximum = (lower - margin <= safe[k].upper() && upper + margin >= safe[k].upper());
+        bool near_safe_minimum = (lower - margin <= safe[k].lower() && upper + margin >= safe[k].lower());
+        if ((near_safe_maximum && derivatives.upper(k)[j] > 0.0) || (near_safe_minimum && derivatives.lower(k)[j] < 0.0)) {
+          location_critical++;
+          break;
+        }
+      }
+    }
+    if (profiler.enabled())
+      profiler.count(it->first.name(),"critical_cells",location_critical);
+    critical += location_critical;
+  }
+  return critical;
+}
+
+// Runs a reach on finer and finer grids, from the given accuracy up to the maximum adaptive one, stopping as soon
+// as no cell calls for a finer grid. Returns the last reach, setting the accuracy it was computed with.
+// Each refinement computes the whole reach again: the analyser refines a grid set only as a whole, and a reach
+// confined to the critical cells would need the entries into them, hence a reach on two grids at once.
+HybridDenotableSet _adaptive_chain_reach(const std::function<HybridDenotableSet(int)>& reach_with_accuracy, int& accuracy) {
+
+  HybridDenotableSet reach;
+  for (;; accuracy++) {
+    reach = reach_with_accuracy(accuracy);
+    unsigned long critical = count_critical_cells(reach,analysed_topology);
+    cout << "Accuracy " << accuracy << ": " << reach.size() << " cells, " << critical << " of them critical." << endl;
+    if (critical == 0 || accuracy >= analysis_settings.maximum_adaptive_accuracy)
+      return reach;
+  }
+}
+
+// Performs infinite time outer evolution, refining the grid only while the reach comes close to the
+// safety bounds, moving towards them
+void adaptive_outer_evolution(HybridAutomatonInterface& system, HybridBoundedConstraintSet& initial_set, int verbosity, bool plot_results) {
+
+  int accuracy = analysis_settings.outer_accuracy;
+  HybridDenotableSet reach = _adaptive_chain_reach([&](int grid_accuracy) {
+    return _outer_chain_reach(system, initial_set, verbosity, grid_accuracy);
+  }, accuracy);
+
+  // Streams the reached region instead of plotting it, if required
+  if (!analysis_settings.stream_prefix.empty()) {
+    ReachStreamWriter sink(analysis_settings.stream_prefix + "adaptive_outer.reach", 2*getTankNumber(initial_set));
+    stream_grid_reach(reach,getAnalysisDomain(system,initial_set),BDD_OUTER,sink,verbosity);
+    return;
+  }
+
+  // Plots the reached region
+  if (plot_results) {
+    std::lock_guard<std::mutex> lock(plot_mutex);
+    PlotHelper plotter(system);
+    plotter.plot(reach,"adaptive_outer",accuracy);
+  }
+}
+
+// Performs infinite time epsilon-lower evolution, refining the grid as the adaptive outer evolution does
+void adaptive_epsilon_lower_evolution(HybridAutomatonInterface& system, HybridBoundedConstraintSet& initial_set, int verbosity, bool plot_results) {
+
+  int accuracy = analysis_settings.lower_accuracy;
+  HybridDenotableSet reach = _adaptive_chain_reach([&](int grid_accuracy) {
+    return _epsilon_lower_chain_reach(system, initial_set, verbosity, grid_accuracy).first;
+  }, accuracy);
+
+  // Streams the reached region instead of plotting it, if required
+  if (!analysis_settings.stream_prefix.empty()) {
+    ReachStreamWriter sink(analysis_settings.stream_prefix + "adaptive_lower.reach", 2*getTankNumber(initial_set));
+    stream_grid_reach(reach,getAnalysisDomain(system,initial_set),BDD_INNER,sink,verbosity);
+    return;
+  }
+
+  // Plots the reached region
+  if (plot_results) {
+    std::lock_guard<std::mutex> lock(plot_mutex);
+    PlotHelper plotter(system);
+    plotter.plot(reach,"adaptive_lower",accuracy);
+  }
+}
+
+// The events taken when going from a location to another, inferred from the components which changed mode:
+// a controller going from rising to falling sent e_close, from falling to rising e_open, and a valve
+// going back to idle took e_idle
+std::vector<String> infer_events(const String& from, const String& to) {
+  std::vector<String> events;
+  std::vector<String> before = split_location(from), after = split_location(to);
+  for (unsigned int i = 0; i < before.size() && i < after.size(); i++) {
+    if (before[i] == after[i])
+      continue;
+    if (before[i].compare(0,6,"rising") == 0)
+      events.push_back("e_close_" + before[i].substr(6));
+    else if (before[i].compare(0,7,"falling") == 0)
+      events.push_back("e_open_" + before[i].substr(7));
+    else if (after[i].compare(0,5,"idle_") == 0)
+      events.push_back("e_idle_" + after[i].substr(5));
+  }
+  return events;
+}
+
+// A step of the trace of a counterexample: the location of an enclosure of the trace, entered within the window
+// starting at the given time, along with the events inferred from the modes changed since the previous step
+struct SafetyTraceStep {
+  double time;
+  String location;
+  std::vector<String> events;
+};
+
+// The outcome of the on-the-fly safety check
+struct SafetyCheckResult {
+  // Whether an enclosure lies entirely outside the safe water levels
+  bool violation;
+  // Whether the violation was confirmed by the native simulation of the centre of the initial set
+  bool confirmed;
+  // Whether the check gave up before the horizon, due to too many enclosures
+  bool inconclusive;
+  // Whether the reach from the evolved points is closed, i.e. no new start was found after the time of the result:
+  // the check then covers an unbounded time
+  bool invariant;
+  // The start of the window where the violation was found, or where the check stopped, or the end
+  // of the window after which the reach is invariant
+  double time;
+  // The trace of the enclosures leading to the violation: the starts of the windows it went through, each one
+  // evolved from the previous one, and the violating enclosure, one step per change of location. The jumps taken
+  // within a window are not told apart, as the orbit of a window does not link its enclosures to one another
+  std::vector<SafetyTraceStep> trace;
+  // The events of the simulation, with their exact times, up to the first unsafe state
+  std::vector<SimulationEvent> simulated_events;
+  double simulated_violation_time;
+};
+
+// The state of the native simulator corresponding to a point of a location of the composed system
+PlantState getPlantState(const DiscreteLocation& location, const Box& box, unsigned int tank_number) {
+  PlantState state;
+  state.time = 0.0;
+  state.levels.resize(2*tank_number);
+  TankVariableIndices indices = getTankVariableIndices(tank_number);
+  for (unsigned int k = 0; k < tank_number; k++) {
+    state.levels[k] = box[indices.waterlevel[k]].midpoint();
+    state.levels[tank_number + k] = box[indices.valvelevel[k]].midpoint();
+  }
+  LocationCodec(tank_number).decode(getLocationCode(location,tank_number),state.valves,state.controllers);
+  return state;
+}
+
+// Simulates the plant from the given state up to the given time, looking for the first recorded state
+// outside the safe water levels; fills the simulated part of the result, returning whether one was found.
+// With non-urgent controllers the simulated run is the one switching at the thresholds, a run of the plant as well
+bool _confirm_violation(const PlantState& initial, double horizon, SafetyCheckResult& result) {
+  SimulationSettings settings;
+  settings.horizon = horizon;
+  settings.record_trajectory = true;
+  SimulationResult simulation = PlantSimulator(analysed_topology).simulate(initial,settings);
+  LocationCodec codec(analysed_topology.size());
+  SafeWaterLevelTable safe_levels(analysed_topology.size());
+  for (unsigned int i = 0; i < simulation.trajectory.size(); i++) {
+    const PlantState& state = simulation.trajectory[i];
+    const std::vector<Interval>& safe = safe_levels[codec.encode(state.valves,state.controllers)];
+    for (unsigned int k = 0; k < analysed_topology.size(); k++) {
+      if (state.levels[k] < safe[k].lower() || state.levels[k] > safe[k].upper()) {
+        result.simulated_violation_time = state.time;
+        for (unsigned int e = 0; e < simulation.events.size() && simulation.events[e].time <= state.time; e++)
+          result.simulated_events.push_back(simulation.events[e]);
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+// The widening of the hull of two boxes, i.e. the largest excess over all the variables of the width of the hull
+// over the larger of the widths of the two boxes
+double hull_widening(const Box& first, const Box& second) {
+  double widening = 0.0;
+  for (unsigned int i = 0; i < first.dimension(); i++) {
+    double hull_width = std::max<double>(first[i].upper(),second[i].upper()) - std::min<double>(first[i].lower(),second[i].lower());
+    double width = std::max<double>(first[i].upper() - first[i].lower(),second[i].upper() - second[i].lower());
+    widening = std::max(widening,hull_width - width);
+  }
+  return widening;
+}
+
+// Whether the first box is contained in the second one
+bool box_subset(const Box& first, const Box& second) {
+  for (unsigned int i = 0; i < first.dimension(); i++) {
+    if (first[i].lower() < second[i].lower() || first[i].upper() > second[i].upper())
+      return false;
+  }
+  return true;
+}
+
+// Evolves the box of each location of the initial set under upper semantics, one time window after another,
+// checking every reach enclosure against the safe water levels as soon as its window is done. The check stops
+// at the first enclosure entirely outside the safe levels: since it is an outer approximation of the states
+// reached along its branch, the violation is definite unless the branch itself is spurious, which is why the
+// trajectory from the centre of the initial box is then simulated natively to confirm it. An unconfirmed violation is
+// reported and the check goes on with the other enclosures.
+// The enclosures ending a window in the same location at the same time may be merged, as set by the merging
+// policy and within the error budget of the settings: a merged
+// enclosure keeps the trace and the simulated state of the first one, while its reach covers the others.
+SafetyCheckResult on_the_fly_safety_check(HybridAutomatonInterface& system, HybridBoundedConstraintSet& initial_set, int verbosity) {
+
+  unsigned int n = getTankNumber(initial_set);
+  SafetyCheckResult result;
+  result.violation = false;
+  result.confirmed = false;
+  result.inconclusive = false;
+  result.invariant = false;
+  result.time = 0.0;
+  result.simulated_violation_time = 0.0;
+
+  // The enclosures to evolve in the next window, each with its trace so far, the simulator state it started from,
+  // the time it is reached at, the code of its location, parsed once when the start is created, and the key of its
+  // class of symmetric starts, if the plant is symmetric
+  struct Start {
+    HybridEvolver::EnclosureType enclosure;
+    std::vector<SafetyTraceStep> trace;
+    PlantState origin;
+    double time;
+    LocationCode code;
+    String key;
+  };
+  std::vector<Start> starts;
+  HybridBoxes initial_set_domain = initial_set.domain();
+  for (HybridBoxes::const_iterator it = initial_set_domain.locations_begin(); it != initial_set_domain.locations_end(); ++it) {
+    if (it->second.empty())
+      continue;
+    Start start = { HybridEvolver::EnclosureType(it->first,it->second), std::vector<SafetyTraceStep>(),
+                    getPlantState(it->first,it->second,n), 0.0, getLocationCode(it->first,n), String() };
+    SafetyTraceStep first = { 0.0, it->first.name(), std::vector<String>() };
+    start.trace.push_back(first);
+    starts.push_back(start);
+  }
+
+  // Keeps one start for each class of starts which are images of one another by swapping identical
+  // branches of the plant, comparing their bounding boxes: the enclosures of the others are images of
+  // the kept one up to the rounding of the evolution, hence they would find the same violations.
+  // The kept starts take the keys of their classes
+  PlantSymmetry symmetry(analysed_topology);
+  bool symmetric = symmetry.is_symmetric() && isSafetySymmetric();
+  auto keep_representatives = [&](std::vector<Start>& candidates) {
+    if (!symmetric)
+      return;
+    std::set<String> keys;
+    std::vector<Start> representatives;
+    for (unsigned int s = 0; s < candidates.size(); s++) {
+      candidates[s].key = getCanonicalKey(symmetry,candidates[s].code,candidates[s].enclosure.second.bounding_box());
+      if (keys.insert(candidates[s].key).second)
+        representatives.push_back(candidates[s]);
+    }
+    if (profiler.enabled())
+      profiler.count("","symmetric_starts",candidates.size() - representatives.size());
+    candidates.swap(representatives);
+  };
+  keep_representatives(starts);
+
+  // The bounding boxes of the starts of all the windows so far, in each location, and the keys of their classes
+  std::map< LocationCode, std::vector<Box> > visited;
+  std::set<String> visited_keys;
+  for (unsigned int s = 0; s < starts.size(); s++) {
+    visited[starts[s].code].push_back(starts[s].enclosure.second.bounding_box());
+    visited_keys.insert(starts[s].key);
+  }
+
+  HybridEvolver evolver(system);
+  evolver.verbosity = verbosity;
+  evolver.settings().set_maximum_step_size(analysis_settings.maximum_step_size);
+
+  TankVariableIndices indices = getTankVariableIndices(n);
+  SafeWaterLevelTable safe_levels(n);
+
+  Profiler::Timer timer(profiler,"on_the_fly_safety");
+  for (double time = 0.0; time < analysis_settings.safety_horizon && !starts.empty(); time += analysis_settings.safety_window) {
+
+    if (!result.violation)
+      result.time = time;
+    if (starts.size() > analysis_settings.maximum_safety_enclosures) {
+      result.inconclusive = true;
+      return result;
+    }
+
+    std::vector<Start> next_starts;
+    double duration = std::min(analysis_settings.safety_window,analysis_settings.safety_horizon - time);
+    HybridTime window(duration,getWindowEventBound(n,duration));
+    for (unsigned int s = 0; s < starts.size(); s++) {
+
+      HybridEvolver::OrbitType orbit = evolver.orbit(starts[s].enclosure,window,UPPER_SEMANTICS);
+      HybridEvolver::EnclosureListType reach = orbit.reach(), final_enclosures = orbit.final();
+      if (profiler.enabled())
+        profile_enclosures(profiler.stage(),reach,"reach_enclosures");
+
+      // Checks the reach of the window; the simulation of a start is the same for all its
+      // enclosures, hence it is run once per window at most. The reach groups its enclosures by
+      // location, hence the safe levels are looked up only when the location changes
+      bool simulated = false;
+      const DiscreteLocation* location = &starts[s].enclosure.first;
+      const std::vector<Interval>* safe_location_levels = &safe_levels[starts[s].code];
+      for (HybridEvolver::EnclosureListType::const_iterator it = reach.begin(); it != reach.end() && !simulated; ++it) {
+        if (!(it->first == *location)) {
+          location = &it->first;
+          safe_location_levels = &safe_levels[getLocationCode(it->first,n)];
+        }
+        const std::vector<Interval>& safe = *safe_location_levels;
+        Box box = it->second.bounding_box();
+        for (unsigned int k = 0; k < n; k++) {
+          const Interval& waterlevel = box[indices.waterlevel[k]];
+          if (waterlevel.lower() > safe[k].upper() || waterlevel.upper() < safe[k].lower()) {
+            result.violation = true;
+            result.trace = starts[s].trace;
+            if (it->first.name() != result.trace.back().location) {
+              SafetyTraceStep step = { time, it->first.name(), infer_events(result.trace.back().location,it->first.name()) };
+              result.trace.push_back(step);
+            }
+            result.simulated_events.clear();
+            result.confirmed = _confirm_violation(starts[s].origin,time + analysis_settings.safety_window,result);
+            if (result.confirmed)
+              return result;
+            simulated = true;
+            break;
+          }
+        }
+      }
+
+      for (HybridEvolver::EnclosureListType::const_iterator it = final_enclosures.begin(); it != final_enclosures.end(); ++it) {
+        Start next = { *it, starts[s].trace, starts[s].origin, time + duration, getLocationCode(it->first,n), String() };
+        if (it->first.name() != next.trace.back().location) {
+          SafetyTraceStep step = { time, it->first.name(), infer_events(next.trace.back().location,it->first.name()) };
+          next.trace.push_back(step);
+        }
+        next_starts.push_back(next);
+      }
+    }
+
+    // Merges the enclosures ending the window in the same location at the same time, each one into the first
+    // merged enclosure whose hull with it stays within the budget, hence the hull is reached at that time as well.
+    // The final enclosures of a window end at its end, since its event bound is out of reach
+    if (analysis_settings.safety_merging == MERGE_BOX_HULL && next_starts.size() > 1) {
+      std::vector<Start> merged;
+      std::vector<Box> boxes;
+      for (unsigned int s = 0; s < next_starts.size(); s++) {
+        Box box = next_starts[s].enclosure.second.bounding_box();
+        bool absorbed = false;
+        for (unsigned int m = 0; m < merged.size() && !absorbed; m++) {
+          if (merged[m].code == next_starts[s].code && merged[m].time == next_starts[s].time
+              && hull_widening(boxes[m],box) <= analysis_settings.safety_merging_budget) {
+            for (unsigned int i = 0; i < box.dimension(); i++)
+              boxes[m][i] = interval_hull(boxes[m][i],box[i]);
+            merged[m].enclosure = HybridEvolver::EnclosureType(merged[m].enclosure.first,boxes[m]);
+            absorbed = true;
+          }
+        }
+        if (!absorbed) {
+          merged.push_back(next_starts[s]);
+          boxes.push_back(box);
+        }
+      }
+      if (profiler.enabled())
+        profiler.count("","merged_enclosures",next_starts.size() - merged.size());
+      next_starts.swap(merged);
+    }
+    keep_representatives(next_starts);
+
+    // Drops the starts inside an earlier start of the same location, or images by symmetry of an earlier start:
+    // their reach is covered by the reach of the earlier one, or by its image, which is evolved up to the horizon
+    // as well. Only the representatives of the symmetric starts are kept as earlier starts. The kept starts are
+    // replaced by their bounding boxes, so that the earlier starts are exactly the sets evolved, each one an outer
+    // approximation of the states reached at its time. When all of them are dropped, the reach found so far is
+    // closed under the evolution, up to the images by symmetry, hence nothing new would be found up to any horizon
+    if (analysis_settings.safety_fixpoint) {
+      std::vector<Start> uncovered;
+      for (unsigned int s = 0; s < next_starts.size(); s++) {
+        Box box = next_starts[s].enclosure.second.bounding_box();
+        std::vector<Box>& earlier = visited[next_starts[s].code];
+        bool covered = (symmetric && visited_keys.count(next_starts[s].key) > 0);
+        for (unsigned int e = 0; e < earlier.size() && !covered; e++)
+          covered = box_subset(box,earlier[e]);
+        if (!covered) {
+          earlier.push_back(box);
+          visited_keys.insert(next_starts[s].key);
+          next_starts[s].enclosure = HybridEvolver::EnclosureType(next_starts[s].enclosure.first,box);
+          uncovered.push_back(next_starts[s]);
+        }
+      }
+      if (profiler.enabled())
+        profiler.count("","covered_starts",next_starts.size() - uncovered.size());
+      next_starts.swap(uncovered);
+      if (next_starts.empty()) {
+        result.invariant = true;
+        if (!result.violation)
+          result.time = std::min(time + analysis_settings.safety_window,analysis_settings.safety_horizon);
+        return result;
+      }
+    }
+    starts.swap(next_starts);
+  }
+  if (!result.violation)
+    result.time = analysis_settings.safety_horizon;
+  return result;
+}
+
+// Prints the outcome of the on-the-fly safety check
+void print_safety_check(const SafetyCheckResult& result) {
+  if (!result.violation) {
+    if (result.invariant)
+      cout << "No violation found, and no new state reached after time " << result.time << ": the reach of the initial set is invariant." << endl;
+    else
+      cout << (result.inconclusive ? "No violation found before giving up at time " : "No violation found up to time ") << result.time << "." << endl;
+    return;
+  }
+  cout << (result.confirmed ? "Safety violated" : "Possible safety violation, not confirmed by simulation,")
+       << " within the window starting at time " << result.time << ". Trace:" << endl;
+  for (unsigned int i = 0; i < result.trace.size(); i++) {
+    const SafetyTraceStep& step = result.trace[i];
+    cout << "  [" << step.time << "," << step.time + analysis_settings.safety_window << "] ";
+    for (unsigned int e = 0; e < step.events.size(); e++)
+      cout << step.events[e] << " ";
+    cout << "-> " << step.location << endl;
+  }
+  if (result.confirmed) {
+    cout << "Simulated trace, leaving the safe levels at time " << result.simulated_violation_time << ":" << endl;
+    for (unsigned int e = 0; e < result.simulated_events.size(); e++)
+      cout << "  t=" << result.simulated_events[e].time << " " << result.simulated_events[e].name << endl;
   }
 }
 
@@ -185,8 +1623,7 @@ void infinite_time_epsilon_lower_evolution(HybridAutomatonInterface& system, Hyb
 void safety_verification(HybridAutomatonInterface& system, HybridBoundedConstraintSet& initial_set, int verbosity, bool plot_results) {
 
   // Creates the domain, necessary to guarantee termination for infinite-time evolution
-  // HybridBoxes domain(system.state_space(),Box(2,0.0,1.0,4.5,9.0));
-  HybridBoxes domain(system.state_space(),Box(6,0.0,1.0,0.0,1.0,0.0,1.0,4.5,9.0,4.5,9.0,4.5,9.0));
+  HybridBoxes domain = getAnalysisDomain(system,initial_set);
   // Creates the safety constraint
   HybridConstraintSet safety_constraint = getSafetyConstraint(system);
 
@@ -197,13 +1634,52 @@ void safety_verification(HybridAutomatonInterface& system, HybridBoundedConstrai
   // The time (in seconds) after which we stop verification
   verifier.ttl = 140;
 
+  // Verifies only one of the initial boxes which are symmetric to each other
+  HybridBoundedConstraintSet reduced_set = getSymmetryReducedInitialSet(system, initial_set);
+
+  // Looks for a counterexample first, which is much quicker to find than a proof of safety
+  if (analysis_settings.early_exit_safety) {
+    SafetyCheckResult check = on_the_fly_safety_check(system, reduced_set, verbosity);
+    print_safety_check(check);
+    if (check.confirmed)
+      return;
+  }
+
   // Collects the verification input
-  SafetyVerificationInput verInput(system, initial_set, domain, safety_constraint);
+  SafetyVerificationInput verInput(system, reduced_set, domain, safety_constraint);
 
   // Performs verification
+  Profiler::Timer timer(profiler,"safety");
   verifier.safety(verInput);
 }
 
+// A box in the parameter space, given as the names of the parameters along with their ranges
+struct ParameterBox {
+  std::vector<String> names;
+  std::vector<Interval> ranges;
+};
+
+// The parameters which are split into disjoint sets by the parametric safety verification
+ParameterBox getSplitParameters() {
+  ParameterBox parameters;
+  parameters.names.push_back("hmin");
+  parameters.ranges.push_back(Interval(5.0,6.0));
+  parameters.names.push_back("hmax");
+  parameters.ranges.push_back(Interval(7.5,8.5));
+  return parameters;
+}
+
+// Converts a parameter box into the set of parameters expected by the verifier
+RealParameterSet getParameterSet(const ParameterBox& box) {
+  RealParameterSet parameters;
+  for (unsigned int i = 0; i < box.names.size(); i++)
+    parameters.insert(RealParameter(box.names[i],box.ranges[i]));
+  return parameters;
+}
+
+list<ParametricOutcome> parallel_parametric_safety(HybridBoundedConstraintSet& initial_set, const ParameterBox& parameters, int depth, unsigned int workers,
+    int verbosity, OutcomeDatabase* database = NULL);
+
 // Performs verification in respect to a safety specification expresses as a set,
 // but it does such verification within a given parameters space, where hmin and hmax
 // are expresses as intervals. Such intervals are then split in order to identify
@@ -211,15 +1687,12 @@ void safety_verification(HybridAutomatonInterface& system, HybridBoundedConstrai
 void parametric_safety_verification(HybridAutomatonInterface& system, HybridBoundedConstraintSet& initial_set, int verbosity, bool plot_results) {
 
   // Creates the domain, necessary to guarantee termination for infinite-time evolution
-  // HybridBoxes domain(system.state_space(),Box(2,0.0,1.0,4.5,9.0));
-  HybridBoxes domain(system.state_space(),Box(6,0.0,1.0,0.0,1.0,0.0,1.0,4.5,9.0,4.5,9.0,4.5,9.0));
+  HybridBoxes domain = getAnalysisDomain(system,initial_set);
   // Creates the safety constraint
   HybridConstraintSet safety_constraint = getSafetyConstraint(system);
 
   // The parameters which will be split into disjoint sets
-  RealParameterSet parameters;
-  parameters.insert(RealParameter("hmin",Interval(5.0,6.0)));
-  parameters.insert(RealParameter("hmax",Interval(7.5,8.5)));
+  RealParameterSet parameters = getParameterSet(getSplitParameters());
 
   // Initialization of the verifier
   Verifier verifier;
@@ -231,43 +1704,338 @@ void parametric_safety_verification(HybridAutomatonInterface& system, HybridBoun
   // In this case we allow 8x8 = 64 disjoint sets. The larger this number, the more accurate the result for each disjoint set.
   verifier.settings().maximum_parameter_depth = 3;
 
-  // Collects the verification input
-  SafetyVerificationInput verInput(system, initial_set, domain, safety_constraint);
+  // Collects the verification input, with only one of the initial boxes which are symmetric to each other
+  HybridBoundedConstraintSet reduced_set = getSymmetryReducedInitialSet(system, initial_set);
+  SafetyVerificationInput verInput(system, reduced_set, domain, safety_constraint);
 
-  // Performs verification, saving the results as a list for each split set
-  list<ParametricOutcome> results = verifier.parametric_safety(verInput, parameters);
+  // Performs verification, saving the results as a list for each split set; with a database of the
+  // outcomes, the boxes are split here instead of by the verifier, one at a time, so that each one
+  // can be looked up and stored
+  list<ParametricOutcome> results;
+  if (analysis_settings.outcome_database.empty()) {
+    results = verifier.parametric_safety(verInput, parameters);
+  } else {
+    OutcomeDatabase database(analysis_settings.outcome_database);
+    results = parallel_parametric_safety(reduced_set, getSplitParameters(), verifier.settings().maximum_parameter_depth, 1, verbosity, &database);
+  }
 
   // Plots the list in a 2d mesh
   if (plot_results) {
+    std::lock_guard<std::mutex> lock(plot_mutex);
     PlotHelper plotter(system);
     plotter.plot(results,verifier.settings().maximum_parameter_depth);
   }
 }
 
-// Constructs the safety constraint for (parametric) safety verification
-HybridConstraintSet getSafetyConstraint(HybridAutomatonInterface& system) {
+// The box of parameters as stored in the database of the outcomes
+StoredBox getStoredBox(const ParameterBox& box) {
+  StoredBox stored;
+  for (unsigned int i = 0; i < box.names.size(); i++) {
+    stored.names.push_back(box.names[i]);
+    stored.lower.push_back(box.ranges[i].lower());
+    stored.upper.push_back(box.ranges[i].upper());
+  }
+  return stored;
+}
+
+// The context of the outcomes of the parametric verification of a box: the plant with its parameters,
+// the initial set, the safe ranges and the time limit of the verifier all take part in the outcome
+String getVerificationContext(HybridBoundedConstraintSet& initial_set, int ttl) {
+  std::ostringstream context;
+  context << std::setprecision(17) << describe(analysed_topology) << "|" << describe_initial_set(initial_set)
+          << "|safe=" << analysis_settings.safe_minimum_waterlevel << "," << analysis_settings.safe_maximum_waterlevel;
+  for (unsigned int k = 0; k < analysis_settings.safe_waterlevels.size(); k++)
+    context << ";" << analysis_settings.safe_waterlevels[k].lower() << "," << analysis_settings.safe_waterlevels[k].upper();
+  for (std::map< String, std::vector<Interval> >::const_iterator it = analysis_settings.location_safe_waterlevels.begin();
+       it != analysis_settings.location_safe_waterlevels.end(); ++it) {
+    context << ";" << it->first;
+    for (unsigned int k = 0; k < it->second.size(); k++)
+      context << ":" << it->second[k].lower() << "," << it->second[k].upper();
+  }
+  context << "|ttl=" << ttl;
+  std::ostringstream key;
+  key << std::hex << text_hash(context.str());
+  return key.str();
+}
+
+// The outcome of a box from the outcomes of the verifier: safe if all of them are, unsafe if any one is
+StoredOutcome combine_outcomes(const list<ParametricOutcome>& outcomes) {
+  StoredOutcome result = OUTCOME_SAFE;
+  for (list<ParametricOutcome>::const_iterator it = outcomes.begin(); it != outcomes.end(); ++it) {
+    tribool outcome = it->getOutcome();
+    if (!possibly(outcome))
+      return OUTCOME_UNSAFE;
+    if (!definitely(outcome))
+      result = OUTCOME_UNDECIDED;
+  }
+  return (outcomes.empty() ? OUTCOME_UNDECIDED : result);
+}
+
+// Performs the same verification as parametric_safety_verification(), but spreads the boxes
+// over a pool of workers. A task holding a box which must be split further submits its
+// halves back to the queue of its worker, where idle workers can steal them; a task
+// holding a box at the given depth verifies it as a whole. Each worker uses its own system
+// and initial set, built from the boxes of the given one. The outcomes are returned as a single list,
+// in no particular order.
+// If a database is given, a box already found safe is not verified nor split any further, a box at
+// the given depth already found unsafe is not verified again, and the new outcomes are stored.
+list<ParametricOutcome> parallel_parametric_safety(HybridBoundedConstraintSet& initial_set, const ParameterBox& parameters, int depth, unsigned int workers,
+    int verbosity, OutcomeDatabase* database) {
+
+  // The time (in seconds) after which the verification of a box stops, as in the sequential verification
+  const int ttl = 140;
+  String context = getVerificationContext(initial_set,ttl);
+
+  WorkStealingPool pool(workers);
+
+  // The per-worker systems and initial sets, built by the workers themselves on their first verification
+  // from their own copies of the initial boxes
+  std::vector< std::unique_ptr<HybridIOAutomaton> > systems(pool.size());
+  std::vector< std::unique_ptr<HybridBoundedConstraintSet> > initial_sets(pool.size());
+  std::vector<HybridBoxes> initial_boxes(pool.size(),initial_set.domain());
+
+  std::mutex results_lock;
+  list<ParametricOutcome> results;
+
+  // The workers record their measures for the stage of the caller
+  String stage = profiler.stage();
+
+  // Verifies a box once it has been split depth times along each parameter
+  std::function<void(WorkStealingPool&,unsigned int,const ParameterBox&,int)> process_box =
+  [&](WorkStealingPool& pool, unsigned int worker, const ParameterBox& box, int remaining_depth) {
+
+    // Reuses the outcome of an earlier run, if decided; an unsafe box is split further if required,
+    // since its sub-boxes may be safe
+    if (database) {
+      StoredOutcome known = database->lookup(context,getStoredBox(box));
+      if (known == OUTCOME_SAFE || (known == OUTCOME_UNSAFE && remaining_depth == 0)) {
+        profiler.count(stage,"","reused_boxes");
+        std::lock_guard<std::mutex> guard(results_lock);
+        results.push_back(ParametricOutcome(getParameterSet(box),tribool(known == OUTCOME_SAFE)));
+        return;
+      }
+    }
+
+    if (remaining_depth > 0) {
+      // Halves every parameter, giving 2^n sub-boxes
+      unsigned int parameter_number = box.names.size();
+      for (unsigned int combination = 0; combination < (1u << parameter_number); combination++) {
+        ParameterBox subbox = box;
+        for (unsigned int i = 0; i < parameter_number; i++) {
+          const Interval& range = box.ranges[i];
+          subbox.ranges[i] = ((combination >> i) & 1) ? Interval(range.midpoint(),range.upper()) : Interval(range.lower(),range.midpoint());
+        }
+        pool.submit(worker,[&process_box,subbox,remaining_depth](WorkStealingPool& pool, unsigned int worker) {
+          process_box(pool,worker,subbox,remaining_depth-1);
+        });
+      }
+      return;
+    }
+
+    if (!systems[worker]) {
+      systems[worker].reset(new HybridIOAutomaton(getAnalysedSystem()));
+      initial_sets[worker].reset(new HybridBoundedConstraintSet(getWorkerInitialSet(*systems[worker],initial_boxes[worker])));
+    }
+    HybridIOAutomaton& system = *systems[worker];
+    HybridBoundedConstraintSet& worker_initial_set = *initial_sets[worker];
+
+    HybridBoxes domain = getAnalysisDomain(system,worker_initial_set);
+    HybridConstraintSet safety_constraint = getSafetyConstraint(system);
+
+    // The box is verified as a whole, with the same time limit as the sequential verification
+    Verifier verifier;
+    verifier.verbosity = verbosity;
+    verifier.settings().plot_results = false;
+    verifier.ttl = ttl;
+    verifier.settings().maximum_parameter_depth = 0;
+
+    SafetyVerificationInput verInput(system, worker_initial_set, domain, safety_constraint);
+    Profiler::Timer timer(profiler,stage,"parametric_box");
+    list<ParametricOutcome> box_results = verifier.parametric_safety(verInput, getParameterSet(box));
+    if (database)
+      database->store(context,getStoredBox(box),combine_outcomes(box_results));
+
+    std::lock_guard<std::mutex> guard(results_lock);
+    results.splice(results.end(),box_results);
+  };
+
+  pool.submit([&process_box,&parameters,depth](WorkStealingPool& pool, unsigned int worker) {
+    process_box(pool,worker,parameters,depth);
+  });
+  pool.run();
+
+  return results;
+}
+
+// Performs parametric safety verification using all the available cores
+void parallel_parametric_safety_verification(HybridAutomatonInterface& system, HybridBoundedConstraintSet& initial_set, int verbosity, bool plot_results) {
+
+  // The number of consecutive splittings for each parameter, as in parametric_safety_verification()
+  int maximum_parameter_depth = 3;
+
+  // Verifies only one of the initial boxes which are symmetric to each other
+  HybridBoundedConstraintSet reduced_set = getSymmetryReducedInitialSet(system, initial_set);
 
-  // The desired constraint is 5.25 <= x <= 8.25 for all locations
-  // The construction below may seem convoluted, however it allows for
-  // large generality when defining the constraint set.
+  std::unique_ptr<OutcomeDatabase> database;
+  if (!analysis_settings.outcome_database.empty())
+    database.reset(new OutcomeDatabase(analysis_settings.outcome_database));
+
+  list<ParametricOutcome> results = parallel_parametric_safety(reduced_set, getSplitParameters(), maximum_parameter_depth,
+      std::thread::hardware_concurrency(), verbosity, database.get());
+
+  // Plots the list in a 2d mesh
+  if (plot_results) {
+    std::lock_guard<std::mutex> lock(plot_mutex);
+    PlotHelper plotter(system);
+    plotter.plot(results,maximum_parameter_depth);
+  }
+}
+
+// Performs outer reachability compositionally, i.e. one tank subsystem (tank, valve and controller) at a time.
+// Each subsystem reads the rest of the plant through held inputs, which take any constant value within
+// the interval assumed for them; the water and valve levels guaranteed by the reach of a subsystem become
+// the assumptions for the subsystems reading them. The iteration stops when the assumptions no longer grow.
+// Please note that inputs held constant do not cover all the ways in which an input can change over time:
+// the result is a cheap estimate of the levels of a large plant, not a proof, and its bounds should be
+// confirmed by the analysis of the whole system. Sound assume-guarantee bounds would need each input to
+// range over its assumed interval at any time, which the reachability analyser cannot express.
+// Returns the final interval for each variable of the plant.
+std::map<String,Interval> compositional_outer_reach(HybridBoundedConstraintSet& initial_set, int verbosity, bool plot_results) {
+
+  unsigned int tank_number = getTankNumber(initial_set);
+  std::vector<String> plant_variables = getTankVariableNames(tank_number);
+
+  // The accuracy of computation in terms of discretization, as in infinite_time_outer_evolution()
+  int accuracy = analysis_settings.outer_accuracy;
+  // The iterations allowed to reach the fixpoint of the assumptions
+  unsigned int maximum_iterations = 10;
+
+  // The assumptions start from the hull of the initial set
+  std::map<String,Interval> assumptions;
+  HybridBoxes initial_set_domain = initial_set.domain();
+  for (HybridBoxes::const_iterator it = initial_set_domain.locations_begin(); it != initial_set_domain.locations_end(); ++it) {
+    if (it->second.empty())
+      continue;
+    for (unsigned int i = 0; i < plant_variables.size(); i++) {
+      const String& name = plant_variables[i];
+      assumptions[name] = (assumptions.count(name) ? interval_hull(assumptions[name],it->second[i]) : it->second[i]);
+    }
+  }
+
+  for (unsigned int iteration = 1; iteration <= maximum_iterations; iteration++) {
+
+    std::map<String,Interval> guarantees = assumptions;
+
+    for (unsigned int k = 0; k < tank_number; k++) {
+
+      std::vector<RealVariable> inputs;
+      DiscreteLocation initial_location;
+      HybridIOAutomaton subsystem = Ariadne::getTankSubsystem(analysed_topology,k,inputs,initial_location);
+
+      // The variables of the subsystem, in alphabetical order as within the system
+      std::vector<String> variables;
+      variables.push_back("valveLevel" + Ariadne::to_string(k));
+      variables.push_back("waterLevel" + Ariadne::to_string(k));
+      for (unsigned int i = 0; i < inputs.size(); i++)
+        variables.push_back(inputs[i].name());
+      std::sort(variables.begin(),variables.end());
+
+      // The initial box holds the current assumptions, while the domain bounds the levels as in the whole plant
+      Box initial_box(variables.size());
+      Box domain_box(variables.size());
+      for (unsigned int i = 0; i < variables.size(); i++) {
+        initial_box[i] = assumptions[variables[i]];
+        domain_box[i] = (variables[i].find("valveLevel") == 0 ? Interval(0.0,1.0) : Interval(4.5,9.0));
+      }
+      HybridBoundedConstraintSet subsystem_initial_set(subsystem.state_space());
+      subsystem_initial_set[initial_location] = initial_box;
+      HybridBoxes domain(subsystem.state_space(),domain_box);
+
+      HybridReachabilityAnalyser analyser(subsystem,domain,accuracy);
+      analyser.verbosity = verbosity;
+      HybridDenotableSet reach = analyser.outer_chain_reach(subsystem_initial_set);
+
+      // The levels of the tank and of its valve are guaranteed by the reach of its subsystem
+      for (HybridDenotableSet::const_iterator it = reach.begin(); it != reach.end(); ++it) {
+        Box cell = it->second.box();
+        for (unsigned int i = 0; i < variables.size(); i++) {
+          if (variables[i] == "valveLevel" + Ariadne::to_string(k) || variables[i] == "waterLevel" + Ariadne::to_string(k))
+            guarantees[variables[i]] = interval_hull(guarantees[variables[i]],cell[i]);
+        }
+      }
+
+      if (plot_results) {
+        std::lock_guard<std::mutex> lock(plot_mutex);
+        PlotHelper plotter(subsystem);
+        plotter.plot(reach,"compositional_outer_" + Ariadne::to_string(k),accuracy);
+      }
+    }
+
+    bool changed = false;
+    for (std::map<String,Interval>::const_iterator it = guarantees.begin(); it != guarantees.end(); ++it) {
+      const Interval& assumption = assumptions[it->first];
+      if (it->second.lower() != assumption.lower() || it->second.upper() != assumption.upper())
+        changed = true;
+    }
+    assumptions = guarantees;
+
+    if (verbosity > 0)
+      cout << "Compositional iteration " << iteration << (changed ? ": assumptions enlarged." : ": fixpoint reached.") << endl;
+    if (!changed)
+      break;
+  }
+
+  return assumptions;
+}
+
+// Performs the compositional outer reachability, printing the resulting level of each tank and valve.
+// The levels are labelled as estimates, since they are not bounds of the whole plant (see compositional_outer_reach)
+void compositional_outer_evolution(HybridAutomatonInterface& system, HybridBoundedConstraintSet& initial_set, int verbosity, bool plot_results) {
+
+  std::map<String,Interval> levels = compositional_outer_reach(initial_set,verbosity,plot_results);
+
+  cout << "Estimated levels, NOT guaranteed bounds: each subsystem holds its inputs constant." << endl;
+  for (std::map<String,Interval>::const_iterator it = levels.begin(); it != levels.end(); ++it)
+    cout << it->first << " estimated in [" << it->second.lower() << "," << it->second.upper() << "]" << endl;
+}
+
+// Constructs the constraint on the water levels of all the tanks, with the given safe ranges: a single vector
+// function gives all the water levels at once, hence an enclosure is checked with one evaluation for all the tanks
+ConstraintSet getWaterLevelConstraint(const std::vector<Interval>& ranges) {
+
+  unsigned int tank_number = ranges.size();
 
   // Constructs the variable list, required by the vector function
-  RealVariable a("a");
-  RealVariable x("x");
-  List<RealVariable> varlist;
   // The variables MUST be appended in the same order as the one used internally by the system,
   // i.e., in alphabetical order
-  varlist.append(a);
-  varlist.append(x);
-  // Constructs the expression
-  RealExpression expr = x;
+  List<RealVariable> varlist;
+  std::vector<String> names = getTankVariableNames(tank_number);
+  for (unsigned int i = 0; i < names.size(); i++)
+    varlist.append(RealVariable(names[i]));
+
+  // Constructs the expressions, one for each water level, and the codomain with their ranges
   List<RealExpression> consexpr;
-  consexpr.append(expr);
+  Box codomain(tank_number);
+  for (unsigned int k = 0; k < tank_number; k++) {
+    consexpr.append(RealExpression(RealVariable("waterLevel" + Ariadne::to_string(k))));
+    codomain[k] = ranges[k];
+  }
   VectorFunction cons_f(consexpr,varlist);
-  // Constructs the codomain for the expression
-  // Questo devo capire bene come funzioni.
-  Box codomain(1,5.25,8.25);
 
-  // Constructs a costraint set and then applies it to each location of the system
-  return HybridConstraintSet(system.state_space(),ConstraintSet(cons_f,codomain));
+  return ConstraintSet(cons_f,codomain);
+}
+
+// Constructs the safety constraint for (parametric) safety verification
+HybridConstraintSet getSafetyConstraint(HybridAutomatonInterface& system) {
+
+  // The desired constraint is the safe range of each water level, 5.25 <= waterLevel <= 8.25 unless
+  // given otherwise in the settings, for all the locations except the ones with their own ranges
+  unsigned int tank_number = analysed_topology.size();
+  HybridConstraintSet constraint(system.state_space(),getWaterLevelConstraint(getSafeWaterLevels(tank_number)));
+
+  for (std::map< String, std::vector<Interval> >::const_iterator it = analysis_settings.location_safe_waterlevels.begin();
+       it != analysis_settings.location_safe_waterlevels.end(); ++it)
+    constraint[DiscreteLocation(it->first)] = getWaterLevelConstraint(getSafeWaterLevels(tank_number,it->first));
+
+  return constraint;
 }
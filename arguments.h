@@ -0,0 +1,73 @@
+/***************************************************************************
+*            arguments.h
+*
+*  This file is used to read the arguments of the executables: numbers
+*  are read whole, so that a typo or a value out of range is reported
+*  instead of being silently taken as zero, and the help option is
+*  recognised before any argument is used.
+*  It depends on the standard library only.
+*
+*  Copyright  2018  Raffaello Corsini, Luca Geretti
+*
+****************************************************************************/
+
+/*
+*  This program is free software; you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation; either version 2 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Library General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program; if not, write to the Free Software
+*  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#ifndef ARGUMENTS_H
+#define ARGUMENTS_H
+
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+namespace Ariadne {
+
+  // Whether any of the arguments asks for the usage, as -h or --help.
+  bool help_requested(int argc, char* argv[]) {
+    for (int i = 1; i < argc; i++) {
+      if (std::strcmp(argv[i],"-h") == 0 || std::strcmp(argv[i],"--help") == 0)
+        return true;
+    }
+    return false;
+  }
+
+  // Reads a whole integer within [minimum,maximum], returning whether the text is one.
+  bool parse_integer(const char* text, long minimum, long maximum, long& value) {
+    char* end;
+    errno = 0;
+    long result = std::strtol(text,&end,10);
+    if (end == text || *end != '\0' || errno == ERANGE || result < minimum || result > maximum)
+      return false;
+    value = result;
+    return true;
+  }
+
+  // Reads a whole finite real number within [minimum,maximum], returning whether the text is one.
+  bool parse_real(const char* text, double minimum, double maximum, double& value) {
+    char* end;
+    errno = 0;
+    double result = std::strtod(text,&end);
+    if (end == text || *end != '\0' || errno == ERANGE || !std::isfinite(result) || result < minimum || result > maximum)
+      return false;
+    value = result;
+    return true;
+  }
+
+}
+
+#endif
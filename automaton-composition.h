@@ -3,7 +3,7 @@
 *
 *  These file is used to describe two functions.
 *  The first is automaton-composition, which compose
-*  a number n of automata in a single one.
+*  a number n of automata in a single one, as a balanced tree.
 *  The second function is used to convert the print of the automaton
 *  in a more understandable way.
 *
@@ -28,44 +28,171 @@
 */
 
 #include <utility>
+#include <algorithm>
+#include <mutex>
 #include <ariadne.h>
 
 namespace Ariadne {
 
-  // Composition of all the automata with the initial location given.
+  /*
+  * The lock serialising the calls to compose(). The automata share their
+  * variables, events and expressions as reference counted objects of the
+  * library, which are not thread safe: no such object may be used by two
+  * threads at once. Hence every thread analysing a system uses one built by
+  * itself, or handed over by a thread waiting for it (see getAnalysedSystem
+  * in analysis.h), and no two compositions run at the same time, even when
+  * distinct threads compose distinct automata.
+  */
+  inline std::mutex& composition_lock() {
+    static std::mutex lock;
+    return lock;
+  }
+
+  /*
+  * Estimate of the cost of composing two automata: the size of the product
+  * of their locations, weighted by the number of variables and events they
+  * share, since each of them has to be matched on every product location.
+  */
+  unsigned long composition_cost(
+    const HybridIOAutomaton& left,
+    const HybridIOAutomaton& right){
+
+      std::set<RealVariable> left_vars = left.input_vars();
+      std::set<RealVariable> left_outputs = left.output_vars();
+      left_vars.insert(left_outputs.begin(),left_outputs.end());
+      std::set<RealVariable> right_vars = right.input_vars();
+      std::set<RealVariable> right_outputs = right.output_vars();
+      right_vars.insert(right_outputs.begin(),right_outputs.end());
+      std::vector<RealVariable> shared_vars;
+      std::set_intersection(left_vars.begin(),left_vars.end(),right_vars.begin(),right_vars.end(),std::back_inserter(shared_vars));
+
+      std::set<DiscreteEvent> left_events = left.input_events();
+      std::set<DiscreteEvent> left_output_events = left.output_events();
+      left_events.insert(left_output_events.begin(),left_output_events.end());
+      std::set<DiscreteEvent> right_events = right.input_events();
+      std::set<DiscreteEvent> right_output_events = right.output_events();
+      right_events.insert(right_output_events.begin(),right_output_events.end());
+      std::vector<DiscreteEvent> shared_events;
+      std::set_intersection(left_events.begin(),left_events.end(),right_events.begin(),right_events.end(),std::back_inserter(shared_events));
+
+      unsigned long locations = left.modes().size() * right.modes().size();
+      return locations * (1 + shared_vars.size() + shared_events.size());
+    }
+
+  /*
+  * Statistics about the locations of a composition. The product of the
+  * location counts is the size of the full product of the components,
+  * while only the locations reachable from the initial one are retained.
+  */
+  struct CompositionStatistics {
+    // Size of the full product of all the components.
+    double product_locations;
+    // Locations retained in the composed automaton.
+    unsigned long reachable_locations;
+    // Sizes of the product and of the retained locations, for each merge.
+    std::vector< pair<double,unsigned long> > merges;
+
+    CompositionStatistics() : product_locations(1.0), reachable_locations(0) { }
+
+    double removed_locations() const { return product_locations - reachable_locations; }
+  };
+
+  /*
+  * Composition of all the automata with the initial location given.
+  * The automata are merged pairwise, in rounds, as a balanced tree: in each
+  * round the cheapest pairs of neighbours are chosen first. The merges run one
+  * at a time, under the composition lock. Only neighbours are merged, hence
+  * the locations of the result are named as with a left-to-right composition,
+  * e.g. "flow0,flow1,...".
+  * Each merge explores the product locations starting from the initial
+  * locations of the two sides, hence the locations which cannot be reached
+  * are never built: their count is reported in the statistics.
+  */
   HybridIOAutomaton composition_all_pieces_together(
-    std::vector< pair<HybridIOAutomaton,DiscreteLocation> > mainVector){
+    const std::vector< pair<HybridIOAutomaton,DiscreteLocation> >& mainVector,
+    CompositionStatistics& statistics){
 
-      /*
-      * Creation of automaton returned by the function.
-      * It's initialised with the first one of the vector
-      * passed as argument.
-      */
-      HybridIOAutomaton system = std::get<0>(mainVector.at(0));
+      // The automata composed until this point, each one with its starting location.
+      std::vector< pair<HybridIOAutomaton,DiscreteLocation> > pieces = mainVector;
 
-      /*
-      * Creation of the location of the automaton composed until this point.
-      * I will use it inside the loop to indicate this as the starting
-      * location of the automaton..
-      */
-      DiscreteLocation location = std::get<1>(mainVector.at(0));
-
-      // Start of the loop to compose with all the other automata.
-      for (unsigned int k = 1; k < mainVector.size(); k++){
-        system = compose(
-          "final_system_" + Ariadne::to_string(k),
-          system,std::get<0>(mainVector.at(k)),
-          location,
-          std::get<1>(mainVector.at(k)));
-          /*
-          * Update of the location desidered for
-          * the automaton composed until this point.
-          */
-          location = DiscreteLocation(location.name() + "," + std::get<1>(mainVector.at(k)).name());
+      // Counter used to label the intermediate automata.
+      unsigned int compositions = 0;
+
+      statistics = CompositionStatistics();
+      for (unsigned int k = 0; k < mainVector.size(); k++){
+        statistics.product_locations *= std::get<0>(mainVector.at(k)).modes().size();
+      }
+
+      while (pieces.size() > 1){
+
+        // Ordering of the pairs of neighbours by increasing cost.
+        std::vector< pair<unsigned long,unsigned int> > candidates;
+        for (unsigned int k = 0; k + 1 < pieces.size(); k++){
+          candidates.push_back(make_pair(composition_cost(std::get<0>(pieces.at(k)),std::get<0>(pieces.at(k+1))),k));
+        }
+        std::sort(candidates.begin(),candidates.end());
+
+        // Choice of disjoint pairs, cheapest first: the first of each pair is marked.
+        std::vector<bool> taken(pieces.size(),false);
+        std::vector<bool> merged_with_next(pieces.size(),false);
+        for (unsigned int c = 0; c < candidates.size(); c++){
+          unsigned int k = std::get<1>(candidates.at(c));
+          if (!taken.at(k) && !taken.at(k+1)){
+            taken.at(k) = taken.at(k+1) = true;
+            merged_with_next.at(k) = true;
+          }
+        }
+
+        // Merges of this round, keeping the order of the pieces.
+        std::vector< pair<HybridIOAutomaton,DiscreteLocation> > next_pieces;
+        for (unsigned int k = 0; k < pieces.size(); k++){
+          if (merged_with_next.at(k)){
+            const pair<HybridIOAutomaton,DiscreteLocation>& left = pieces.at(k);
+            const pair<HybridIOAutomaton,DiscreteLocation>& right = pieces.at(k+1);
+            String name = "final_system_" + Ariadne::to_string(++compositions);
+            DiscreteLocation location(std::get<1>(left).name() + "," + std::get<1>(right).name());
+            HybridIOAutomaton merged = [&]() -> HybridIOAutomaton {
+              std::lock_guard<std::mutex> guard(composition_lock());
+              return compose(name,std::get<0>(left),std::get<0>(right),std::get<1>(left),std::get<1>(right));
+            }();
+            double product = (double)std::get<0>(pieces.at(k)).modes().size() * std::get<0>(pieces.at(k+1)).modes().size();
+            statistics.merges.push_back(make_pair(product,(unsigned long)merged.modes().size()));
+            next_pieces.push_back(make_pair(merged,location));
+            k++;
+          } else {
+            next_pieces.push_back(pieces.at(k));
+          }
         }
+        pieces.swap(next_pieces);
+      }
+
+      statistics.reachable_locations = std::get<0>(pieces.at(0)).modes().size();
+
+      return std::get<0>(pieces.at(0));
+    }
+
+  // Composition of all the automata, optionally reporting how many product locations were removed.
+  HybridIOAutomaton composition_all_pieces_together(
+    const std::vector< pair<HybridIOAutomaton,DiscreteLocation> >& mainVector,
+    int verbosity = 0){
+
+      CompositionStatistics statistics;
+      HybridIOAutomaton system = composition_all_pieces_together(mainVector,statistics);
 
-        return system;
+      if (verbosity > 0){
+        cout << "Composition: " << statistics.reachable_locations << " reachable locations out of "
+             << statistics.product_locations << " in the full product, "
+             << statistics.removed_locations() << " removed." << endl;
       }
+      if (verbosity > 1){
+        for (unsigned int k = 0; k < statistics.merges.size(); k++){
+          cout << "  merge " << k+1 << ": " << std::get<1>(statistics.merges.at(k)) << " of "
+               << std::get<0>(statistics.merges.at(k)) << " locations retained." << endl;
+        }
+      }
+
+      return system;
+    }
 
       /*
       * This is a function used to replace de occurences of ", "
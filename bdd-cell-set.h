@@ -0,0 +1,373 @@
+/***************************************************************************
+*            bdd-cell-set.h
+*
+*  This file is used to describe a set of grid cells of the hybrid state
+*  space stored as a binary decision diagram, using the BuDDy library.
+*  The domain of each location is divided into 2^bits intervals along
+*  each dimension, so that a cell is a tuple of integer coordinates, and
+*  a set of cells is the boolean function of the bits of the location and
+*  of the coordinates telling whether the cell belongs to it. The bits of
+*  the dimensions are interleaved, the most significant first, so that
+*  neighbouring cells share most of their diagram: the regular sets
+*  produced by the reachability analyses then take far less memory than
+*  their explicit cells. Union, intersection and inclusion work on the
+*  diagrams, without listing the cells.
+*  The diagrams only compress the results once they are computed: the
+*  reachability analyser still builds every grid set explicitly, cell by
+*  cell, and the cells are converted afterwards, hence the peak memory of
+*  a reach is that of its explicit grid set.
+*  It uses the C++ interface of BuDDy, whose bdd objects count their
+*  references. BuDDy is not thread safe, hence all the operations, and
+*  the copies and destructions of the bdd objects, take a global lock.
+*  The variables of a destroyed encoding are reused by the next one of
+*  the same size, since the library cannot release them.
+*  The sets are defined only when WATERWORLD_HAS_BUDDY is, as set by the
+*  build when it finds the library.
+*
+*  Copyright  2018  Raffaello Corsini, Luca Geretti
+*
+****************************************************************************/
+
+/*
+*  This program is free software; you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation; either version 2 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Library General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program; if not, write to the Free Software
+*  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#ifndef BDD_CELL_SET_H
+#define BDD_CELL_SET_H
+
+#ifdef WATERWORLD_HAS_BUDDY
+#include <bdd.h>
+#endif
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace Ariadne {
+
+  // How a box not aligned to the grid is turned into cells.
+  enum BddRounding {
+    // All the cells intersecting the box, for outer approximations.
+    BDD_OUTER,
+    // Only the cells contained in the box, for inner (lower) approximations.
+    BDD_INNER
+  };
+
+#ifdef WATERWORLD_HAS_BUDDY
+
+  // The global lock of the library, which is initialised on first use.
+  inline std::mutex& bdd_lock() {
+    static std::mutex lock;
+    return lock;
+  }
+
+  // The first variables of the blocks released by the destroyed encodings, by the size of the block.
+  inline std::multimap<int,int>& bdd_free_variables() {
+    static std::multimap<int,int> blocks;
+    return blocks;
+  }
+
+  /*
+  * How the cells are encoded: the domain, the number of bits of each coordinate
+  * and of the location identifiers, and the variables of the library used.
+  * Sets sharing an encoding can be combined.
+  */
+  class BddCellEncoding {
+
+      friend class BddCellSet;
+
+      std::vector<double> _lower;
+      std::vector<double> _upper;
+      unsigned int _bits;
+      unsigned int _location_bits;
+      int _first_variable;
+      int _variable_number;
+      // The variables of the encoding, as a set for counting.
+      bdd _variables;
+      std::map<std::string,unsigned int> _location_ids;
+      std::vector<std::string> _location_names;
+
+    public:
+
+      /*
+      * An encoding of the cells of the given domain, with 2^bits intervals along each
+      * dimension, for at most the given number of distinct locations.
+      */
+      BddCellEncoding(const std::vector<double>& lower, const std::vector<double>& upper, unsigned int bits, unsigned long maximum_locations)
+        : _lower(lower), _upper(upper), _bits(bits), _location_bits(0) {
+        std::lock_guard<std::mutex> guard(bdd_lock());
+        while ((1ul << _location_bits) < maximum_locations)
+          _location_bits++;
+        _variable_number = _location_bits + _bits * _lower.size();
+        std::multimap<int,int>::iterator block = bdd_free_variables().find(_variable_number);
+        if (block != bdd_free_variables().end()) {
+          _first_variable = block->second;
+          bdd_free_variables().erase(block);
+        } else if (!bdd_isrunning()) {
+          bdd_init(1000000,100000);
+          bdd_setvarnum(_variable_number);
+          _first_variable = 0;
+        } else {
+          _first_variable = bdd_varnum();
+          bdd_extvarnum(_variable_number);
+        }
+        std::vector<int> indices(_variable_number);
+        for (int i = 0; i < _variable_number; i++)
+          indices[i] = _first_variable + i;
+        _variables = bdd_makeset(indices.data(),_variable_number);
+      }
+
+      ~BddCellEncoding() {
+        std::lock_guard<std::mutex> guard(bdd_lock());
+        _variables = bddfalse;
+        bdd_free_variables().insert(std::make_pair(_variable_number,_first_variable));
+      }
+
+      unsigned int dimension() const { return _lower.size(); }
+      unsigned int bits() const { return _bits; }
+      const std::vector<std::string>& locations() const { return _location_names; }
+
+    private:
+
+      int _location_variable(unsigned int bit) const { return _first_variable + bit; }
+      // The variable of the bit at the given level (0 is the most significant) of a coordinate.
+      int _coordinate_variable(unsigned int dimension, unsigned int level) const {
+        return _first_variable + _location_bits + level * _lower.size() + dimension;
+      }
+
+      unsigned int _location_id(const std::string& location) {
+        std::map<std::string,unsigned int>::const_iterator it = _location_ids.find(location);
+        if (it != _location_ids.end())
+          return it->second;
+        if (_location_names.size() >= (1ul << _location_bits))
+          throw std::runtime_error("Too many locations for the encoding of the cells.");
+        _location_ids[location] = _location_names.size();
+        _location_names.push_back(location);
+        return _location_names.size() - 1;
+      }
+
+      // The range of coordinates covering, or contained in, an interval along a dimension;
+      // the range is empty when first > last.
+      void _range(unsigned int dimension, double lower, double upper, BddRounding rounding, long& first, long& last) const {
+        double cells = (double)(1ul << _bits);
+        double scale = cells / (_upper[dimension] - _lower[dimension]);
+        double from = (lower - _lower[dimension]) * scale, to = (upper - _lower[dimension]) * scale;
+        if (rounding == BDD_OUTER) {
+          first = (long)std::floor(from);
+          last = (long)std::ceil(to) - 1;
+          if (last < first)
+            last = first;
+        } else {
+          first = (long)std::ceil(from);
+          last = (long)std::floor(to) - 1;
+        }
+        first = std::max(first,0l);
+        last = std::min(last,(long)cells - 1);
+      }
+
+      // The function of the coordinate bits which is true iff the coordinate is at most (or at least) the value.
+      bdd _compare(unsigned int dimension, unsigned long value, bool at_most) const {
+        bdd result = bddtrue;
+        for (unsigned int level = _bits; level-- > 0; ) {
+          unsigned int bit = _bits - 1 - level;
+          bdd variable = (at_most ? bdd_nithvar(_coordinate_variable(dimension,level)) : bdd_ithvar(_coordinate_variable(dimension,level)));
+          bool set = ((value >> bit) & 1);
+          result = (set == at_most ? variable | result : variable & result);
+        }
+        return result;
+      }
+
+      // The function of the location bits which is true for the given location.
+      bdd _location(unsigned int id) const {
+        bdd result = bddtrue;
+        for (unsigned int bit = 0; bit < _location_bits; bit++)
+          result = result & (((id >> bit) & 1) ? bdd_ithvar(_location_variable(bit)) : bdd_nithvar(_location_variable(bit)));
+        return result;
+      }
+  };
+
+  class BddCellSet {
+
+      std::shared_ptr<BddCellEncoding> _encoding;
+      // Assigned and released only within the lock, being set to false before the destruction.
+      bdd _root;
+
+      void _check(const BddCellSet& other) const {
+        if (_encoding != other._encoding)
+          throw std::invalid_argument("The cell sets have different encodings.");
+      }
+
+      // Calls the function for each box, expanding the don't care bits which are above a fixed bit
+      // of the same coordinate, since only the trailing ones give a contiguous range.
+      void _expand(std::vector<signed char>& values, const std::function<void(const std::string&, const std::vector<double>&, const std::vector<double>&)>& function) const {
+        const BddCellEncoding& encoding = *_encoding;
+        unsigned int first = encoding._first_variable;
+        for (unsigned int bit = 0; bit < encoding._location_bits; bit++) {
+          signed char& value = values[encoding._location_variable(bit) - first];
+          if (value < 0) {
+            value = 0; _expand(values,function);
+            value = 1; _expand(values,function);
+            value = -1;
+            return;
+          }
+        }
+        for (unsigned int d = 0; d < encoding.dimension(); d++) {
+          bool fixed_below = false;
+          for (unsigned int level = encoding._bits; level-- > 0; ) {
+            signed char& value = values[encoding._coordinate_variable(d,level) - first];
+            if (value >= 0) {
+              fixed_below = true;
+            } else if (fixed_below) {
+              value = 0; _expand(values,function);
+              value = 1; _expand(values,function);
+              value = -1;
+              return;
+            }
+          }
+        }
+        unsigned int id = 0;
+        for (unsigned int bit = 0; bit < encoding._location_bits; bit++)
+          id |= (values[encoding._location_variable(bit) - first] << bit);
+        if (id >= encoding._location_names.size())
+          return;
+        std::vector<double> lower(encoding.dimension()), upper(encoding.dimension());
+        double cells = (double)(1ul << encoding._bits);
+        for (unsigned int d = 0; d < encoding.dimension(); d++) {
+          unsigned long from = 0, to = 0;
+          for (unsigned int level = 0; level < encoding._bits; level++) {
+            signed char value = values[encoding._coordinate_variable(d,level) - first];
+            from = (from << 1) | (value > 0 ? 1 : 0);
+            to = (to << 1) | (value != 0 ? 1 : 0);
+          }
+          double width = (encoding._upper[d] - encoding._lower[d]) / cells;
+          lower[d] = encoding._lower[d] + from * width;
+          upper[d] = encoding._lower[d] + (to + 1) * width;
+        }
+        function(encoding._location_names[id],lower,upper);
+      }
+
+    public:
+
+      // An empty set with the given encoding.
+      BddCellSet(const std::shared_ptr<BddCellEncoding>& encoding) : _encoding(encoding) { }
+
+      BddCellSet(const BddCellSet& other) : _encoding(other._encoding) {
+        std::lock_guard<std::mutex> guard(bdd_lock());
+        _root = other._root;
+      }
+
+      BddCellSet& operator=(const BddCellSet& other) {
+        // The previous encoding is released out of the lock, since its destruction takes it
+        std::shared_ptr<BddCellEncoding> previous = _encoding;
+        std::lock_guard<std::mutex> guard(bdd_lock());
+        _encoding = other._encoding;
+        _root = other._root;
+        return *this;
+      }
+
+      ~BddCellSet() {
+        std::lock_guard<std::mutex> guard(bdd_lock());
+        _root = bddfalse;
+      }
+
+      const std::shared_ptr<BddCellEncoding>& encoding() const { return _encoding; }
+
+      // Adds the cells of a box in a location, rounded to the grid of the encoding.
+      void adjoin(const std::string& location, const std::vector<double>& lower, const std::vector<double>& upper, BddRounding rounding = BDD_OUTER) {
+        std::lock_guard<std::mutex> guard(bdd_lock());
+        BddCellEncoding& encoding = *_encoding;
+        bdd cube = encoding._location(encoding._location_id(location));
+        for (unsigned int d = 0; d < encoding.dimension() && cube != bddfalse; d++) {
+          long first, last;
+          encoding._range(d,lower[d],upper[d],rounding,first,last);
+          if (first <= last)
+            cube = cube & encoding._compare(d,first,false) & encoding._compare(d,last,true);
+          else
+            cube = bddfalse;
+        }
+        _root = _root | cube;
+      }
+
+      // Adds all the cells of another set.
+      void adjoin(const BddCellSet& other) {
+        _check(other);
+        std::lock_guard<std::mutex> guard(bdd_lock());
+        _root = _root | other._root;
+      }
+
+      // Keeps only the cells which are also in another set.
+      void restrict(const BddCellSet& other) {
+        _check(other);
+        std::lock_guard<std::mutex> guard(bdd_lock());
+        _root = _root & other._root;
+      }
+
+      // Whether all the cells are also in another set.
+      bool subset(const BddCellSet& other) const {
+        _check(other);
+        std::lock_guard<std::mutex> guard(bdd_lock());
+        return (_root & !other._root) == bddfalse;
+      }
+
+      bool empty() const {
+        std::lock_guard<std::mutex> guard(bdd_lock());
+        return _root == bddfalse;
+      }
+
+      // The number of cells of the grid of the encoding in the set.
+      double cell_count() const {
+        std::lock_guard<std::mutex> guard(bdd_lock());
+        return bdd_satcountset(_root,_encoding->_variables);
+      }
+
+      // The number of nodes of the diagram, which tells the memory taken.
+      int node_count() const {
+        std::lock_guard<std::mutex> guard(bdd_lock());
+        return bdd_nodecount(_root);
+      }
+
+      /*
+      * Calls the function for boxes of cells covering the set exactly, each one given
+      * by its location and its bounds; the boxes are as large as the diagram allows.
+      */
+      void for_each_box(const std::function<void(const std::string&, const std::vector<double>&, const std::vector<double>&)>& function) const {
+        // The library calls a plain function for each assignment, hence the context is kept aside
+        static const BddCellSet* current;
+        static const std::function<void(const std::string&, const std::vector<double>&, const std::vector<double>&)>* current_function;
+        struct Handler {
+          static void call(char* values, int size) {
+            unsigned int first = current->_encoding->_first_variable;
+            unsigned int variables = current->_encoding->_variable_number;
+            std::vector<signed char> own(values + first,values + std::min<int>(size,first + variables));
+            current->_expand(own,*current_function);
+          }
+        };
+        std::lock_guard<std::mutex> guard(bdd_lock());
+        current = this;
+        current_function = &function;
+        bdd_allsat(_root,&Handler::call);
+      }
+  };
+
+#endif
+
+}
+
+#endif
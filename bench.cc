@@ -0,0 +1,255 @@
+/***************************************************************************
+*            bench.cc
+*
+*  The benchmark of the analyses. Each analysis is run on binary trees of
+*  tanks of growing size, for several accuracies (for the grid based
+*  analyses) and maximum step sizes (for the finite time evolutions and
+*  the on-the-fly safety check). The safety verifications, plain and
+*  parametric, are run with the settings of the verifier, hence with no
+*  step size of their own, the parametric one on a coarser split of the
+*  parameters to keep the runs short.
+*  Every run records its wall time, its peak resident memory, the number
+*  of enclosures or grid cells obtained and the outcome of a verification,
+*  as a line of CSV.
+*  Each run takes place in its own process, so that the peak memory
+*  belongs to that run only.
+*
+*  Usage: waterworld_bench [maximum number of tanks] [output.csv]
+*
+*  Copyright  2018  Raffaello Corsini, Luca Geretti
+*
+****************************************************************************/
+
+/*
+*  This program is free software; you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation; either version 2 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Library General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program; if not, write to the Free Software
+*  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#include <ariadne.h> // Library header
+#include <cstring>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "system.h" // System definition
+#include "analysis.h" // Custom analysis routines to be run
+
+// A single run of the benchmark
+struct BenchmarkCase {
+  String analysis;
+  unsigned int tanks;
+  int accuracy;
+  // The maximum step size, or zero for the verifications, which choose their own
+  double step_size;
+};
+
+// The number of splittings of each parameter by the parametric safety cases, i.e. 2^depth ranges each
+const int parametric_depth = 1;
+
+// The outcome of a verification, as written in the CSV
+String outcome_name(tribool outcome) {
+  return (definitely(outcome) ? "safe" : (!possibly(outcome) ? "unsafe" : "undecided"));
+}
+
+// Runs a case, returning the CSV line with its measures
+String run_case(const BenchmarkCase& bench) {
+
+  if (bench.step_size > 0)
+    analysis_settings.maximum_step_size = bench.step_size;
+  analysis_settings.outer_accuracy = bench.accuracy;
+  analysis_settings.lower_accuracy = bench.accuracy;
+
+  // The system is composed before starting the clock: composition is not part of the analyses
+  analysed_topology = getBinaryTreeTopology(bench.tanks);
+  // The cases on the controllers with a delta band, whose enclosures split at every switch, compare the
+  // on-the-fly safety check with and without merging them
+  analysed_topology.urgent_controllers = (bench.analysis.find("_delta") == String::npos);
+  analysis_settings.safety_merging = (bench.analysis == "on_the_fly_safety_delta_unmerged" ? MERGE_NONE : MERGE_BOX_HULL);
+  HybridIOAutomaton system = getAnalysedSystem();
+  HybridBoundedConstraintSet initial_set(system.state_space());
+  initial_set[getInitialLocation(analysed_topology)] = getTankBox(bench.tanks, Interval(1.0,1.0), Interval(7.0,7.0));
+
+  unsigned long enclosures = 0;
+  unsigned long cells = 0;
+  String outcome;
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  if (bench.analysis == "finite_upper") {
+    enclosures = _finite_time_evolution(system, initial_set, UPPER_SEMANTICS, 0).size();
+  } else if (bench.analysis == "finite_lower") {
+    enclosures = _finite_time_evolution(system, initial_set, LOWER_SEMANTICS, 0).size();
+  } else if (bench.analysis == "outer") {
+    cells = _outer_chain_reach(system, initial_set, 0, bench.accuracy).size();
+  } else if (bench.analysis == "epsilon_lower") {
+    cells = _epsilon_lower_chain_reach(system, initial_set, 0, bench.accuracy).first.size();
+  } else if (bench.analysis == "safety") {
+    // As safety_verification(), without looking for a counterexample first
+    Verifier verifier;
+    verifier.ttl = 140;
+    HybridBoundedConstraintSet reduced_set = getSymmetryReducedInitialSet(system, initial_set);
+    HybridBoxes domain = getAnalysisDomain(system,initial_set);
+    HybridConstraintSet safety_constraint = getSafetyConstraint(system);
+    SafetyVerificationInput verInput(system, reduced_set, domain, safety_constraint);
+    outcome = outcome_name(verifier.safety(verInput));
+  } else if (bench.analysis == "parametric_safety") {
+    // As parametric_safety_verification(), on the coarser split
+    Verifier verifier;
+    verifier.ttl = 140;
+    verifier.settings().maximum_parameter_depth = parametric_depth;
+    HybridBoundedConstraintSet reduced_set = getSymmetryReducedInitialSet(system, initial_set);
+    HybridBoxes domain = getAnalysisDomain(system,initial_set);
+    HybridConstraintSet safety_constraint = getSafetyConstraint(system);
+    SafetyVerificationInput verInput(system, reduced_set, domain, safety_constraint);
+    list<ParametricOutcome> results = verifier.parametric_safety(verInput, getParameterSet(getSplitParameters()));
+    unsigned int safe = 0;
+    for (list<ParametricOutcome>::const_iterator it = results.begin(); it != results.end(); ++it) {
+      if (definitely(it->getOutcome()))
+        safe++;
+    }
+    outcome = Ariadne::to_string(safe) + " of " + Ariadne::to_string(results.size()) + " safe";
+  } else if (bench.analysis.compare(0,17,"on_the_fly_safety") == 0) {
+    HybridBoundedConstraintSet reduced_set = getSymmetryReducedInitialSet(system, initial_set);
+    SafetyCheckResult check = on_the_fly_safety_check(system, reduced_set, 0);
+    if (check.violation)
+      outcome = (check.confirmed ? "violated" : "possibly violated");
+    else
+      outcome = (check.invariant ? "invariant" : (check.inconclusive ? "inconclusive" : "no violation"));
+  }
+  double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  // The peak resident memory of this process, in kilobytes
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+
+  std::ostringstream line;
+  line << bench.analysis << "," << bench.tanks << "," << bench.accuracy << ",";
+  if (bench.step_size > 0)
+    line << bench.step_size;
+  line << "," << elapsed << "," << usage.ru_maxrss << "," << enclosures << "," << cells << "," << outcome;
+  return line.str();
+}
+
+// The exit status of a child which ran a case, if it failed
+const int CHILD_WRITE_FAILED = 1;
+const int CHILD_EXCEPTION = 2;
+
+/*
+ * Runs a case in a child process, returning its CSV line, or an empty string if the run
+ * failed, in which case failure tells why: an exception, an exit status or a signal
+ */
+String run_case_in_child(const BenchmarkCase& bench, String& failure) {
+
+  failure = "";
+  int channel[2];
+  if (pipe(channel) != 0) {
+    failure = "no pipe to the child";
+    return "";
+  }
+
+  pid_t pid = fork();
+  if (pid < 0) {
+    close(channel[0]);
+    close(channel[1]);
+    failure = "no child process";
+    return "";
+  }
+  if (pid == 0) {
+    close(channel[0]);
+    String line;
+    try {
+      line = run_case(bench);
+    } catch (std::exception& ex) {
+      std::cerr << bench.analysis << " on " << bench.tanks << " tanks failed: " << ex.what() << std::endl;
+      _exit(CHILD_EXCEPTION);
+    }
+    if (write(channel[1], line.c_str(), line.size()) < 0)
+      _exit(CHILD_WRITE_FAILED);
+    _exit(0);
+  }
+
+  close(channel[1]);
+  String line;
+  char buffer[256];
+  ssize_t length;
+  while ((length = read(channel[0], buffer, sizeof(buffer))) > 0)
+    line.append(buffer, length);
+  close(channel[0]);
+  int status;
+  if (waitpid(pid, &status, 0) < 0) {
+    failure = "lost the child process";
+    return "";
+  }
+  if (WIFSIGNALED(status)) {
+    failure = String("killed by signal ") + Ariadne::to_string(WTERMSIG(status)) + " (" + strsignal(WTERMSIG(status)) + ")";
+    return "";
+  }
+  if (WIFEXITED(status) && WEXITSTATUS(status) != 0) {
+    failure = (WEXITSTATUS(status) == CHILD_EXCEPTION ? String("exception thrown")
+                                                       : String("exit status ") + Ariadne::to_string(WEXITSTATUS(status)));
+    return "";
+  }
+  if (line.empty())
+    failure = "no result";
+  return line;
+}
+
+int main(int argc,char *argv[])
+{
+  // The largest binary tree of tanks to be analysed
+  unsigned int maximum_tanks = 7;
+  if (argc > 1)
+  maximum_tanks = atoi(argv[1]);
+
+  String filename = "waterworld_bench.csv";
+  if (argc > 2)
+  filename = argv[2];
+
+  // The grid of the benchmark: the accuracy matters only for the grid based analyses,
+  // the step size only for the finite time evolutions and the on-the-fly safety check
+  std::vector<unsigned int> sizes;
+  for (unsigned int tanks = 3; tanks <= maximum_tanks; tanks += 2)
+    sizes.push_back(tanks);
+  std::vector<int> accuracies = {1, 2};
+  std::vector<double> step_sizes = {0.3, 0.6, 1.2};
+
+  std::vector<BenchmarkCase> cases;
+  for (unsigned int i = 0; i < sizes.size(); i++) {
+    for (unsigned int j = 0; j < step_sizes.size(); j++) {
+      cases.push_back({"finite_upper", sizes[i], analysis_settings.outer_accuracy, step_sizes[j]});
+      cases.push_back({"finite_lower", sizes[i], analysis_settings.outer_accuracy, step_sizes[j]});
+      cases.push_back({"on_the_fly_safety", sizes[i], analysis_settings.outer_accuracy, step_sizes[j]});
+      cases.push_back({"on_the_fly_safety_delta", sizes[i], analysis_settings.outer_accuracy, step_sizes[j]});
+      cases.push_back({"on_the_fly_safety_delta_unmerged", sizes[i], analysis_settings.outer_accuracy, step_sizes[j]});
+    }
+    for (unsigned int j = 0; j < accuracies.size(); j++) {
+      cases.push_back({"outer", sizes[i], accuracies[j], analysis_settings.maximum_step_size});
+      cases.push_back({"epsilon_lower", sizes[i], accuracies[j], analysis_settings.maximum_step_size});
+    }
+    cases.push_back({"safety", sizes[i], analysis_settings.outer_accuracy, 0});
+    cases.push_back({"parametric_safety", sizes[i], analysis_settings.outer_accuracy, 0});
+  }
+
+  std::ofstream csv(filename.c_str());
+  csv << "analysis,tanks,accuracy,step_size,wall_time_s,peak_rss_kb,enclosures,grid_cells,outcome" << endl;
+  for (unsigned int i = 0; i < cases.size(); i++) {
+    cout << i+1 << "/" << cases.size() << ": " << cases[i].analysis << " on " << cases[i].tanks << " tanks... " << flush;
+    String failure;
+    String line = run_case_in_child(cases[i], failure);
+    if (line.empty()) {
+      cout << "failed: " << failure << "." << endl;
+      continue;
+    }
+    csv << line << endl << flush;
+    cout << "done." << endl;
+  }
+}
@@ -73,4 +73,49 @@ namespace Ariadne {
         return tank;
       }
 
+  /*
+  * Function returning the desired automata for a bottom_tank with any
+  * number of upper tanks. It takes in input the waterlevel, the
+  * upper_waterlevels, the upper_valvelevel, the upper_output_flows
+  * and its internal_output_flow.
+  */
+  HybridIOAutomaton getBottomTank(
+    RealVariable internal_waterlevel,
+    std::vector<RealVariable> upper_waterlevels,
+    RealVariable upper_valvelevel,
+    std::vector<RealParameter> upper_output_flows,
+    RealParameter lower_output_flow,
+    int progressive){
+
+      // Conversion of the progressive integer to a String.
+      String number = Ariadne::to_string(progressive);
+
+      // Creation of the automaton, with a progressive label.
+      HybridIOAutomaton tank("tank" + number);
+
+      // Adding the input/output vars.
+      tank.add_input_var(upper_valvelevel);
+      for (unsigned int k = 0; k < upper_waterlevels.size(); k++){
+        tank.add_input_var(upper_waterlevels.at(k));
+      }
+      tank.add_output_var(internal_waterlevel);
+
+      // Creation of the location.
+      DiscreteLocation bottom_tank_flow("flow" + number);
+      // Adding the location to the automaton.
+      tank.new_mode(bottom_tank_flow);
+
+      // What goes out.
+      RealExpression dynamics = - lower_output_flow * internal_waterlevel;
+      // What comes in from each upper tank.
+      for (unsigned int k = 0; k < upper_waterlevels.size(); k++){
+        dynamics = dynamics + upper_output_flows.at(k) * ( upper_valvelevel / 2 ) * upper_waterlevels.at(k);
+      }
+
+      // Setting the dynamics
+      tank.set_dynamics(bottom_tank_flow, internal_waterlevel, dynamics);
+
+        return tank;
+      }
+
     }
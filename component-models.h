@@ -0,0 +1,179 @@
+/***************************************************************************
+*            component-models.h
+*
+*  This file is used to describe the components of the plant as models
+*  whose structure is fixed at compile time: the number of variables, of
+*  modes and of guards of each component, and the shape of its dynamics
+*  and guards, as in getSideTank, getMiddleTank, getBottomTank, getValve
+*  and getUrgentController. A binary tree of tanks of a given size is then
+*  a template, whose vector field is plain inlined code with the loops
+*  over the tanks of known length and the connections of the tanks known
+*  constants. The parameters (flows, thresholds, opening time) are still
+*  taken from a topology at run time.
+*  It depends on the standard library only.
+*
+*  Copyright  2018  Raffaello Corsini, Luca Geretti
+*
+****************************************************************************/
+
+/*
+*  This program is free software; you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation; either version 2 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Library General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program; if not, write to the Free Software
+*  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#ifndef COMPONENT_MODELS_H
+#define COMPONENT_MODELS_H
+
+#include "topology.h"
+
+namespace Ariadne {
+
+  // A tank: its water level, in a single mode with no guards.
+  struct TankModel {
+    static constexpr unsigned int variables = 1;
+    static constexpr unsigned int modes = 1;
+    static constexpr unsigned int guards = 0;
+
+    // The flow entering a side tank through its own valve.
+    static constexpr double source_inflow(double input_flow, double valvelevel) {
+      return input_flow * valvelevel;
+    }
+    // The flow entering from an upper tank, through the valve of this one.
+    static constexpr double upper_inflow(double upper_output_flow, double valvelevel, double upper_waterlevel) {
+      return upper_output_flow * (valvelevel / 2) * upper_waterlevel;
+    }
+    // The flow leaving towards a lower tank, through the valve of the lower tank.
+    static constexpr double lower_outflow(double output_flow, double lower_valvelevel, double waterlevel) {
+      return output_flow * (lower_valvelevel / 2) * waterlevel;
+    }
+    // The flow leaving the bottom tank.
+    static constexpr double bottom_outflow(double output_flow, double waterlevel) {
+      return output_flow * waterlevel;
+    }
+  };
+
+  // A valve: its level, in the idle, opening and closing modes, with a guard for each moving mode.
+  struct ValveModel {
+    static constexpr unsigned int variables = 1;
+    static constexpr unsigned int modes = 3;
+    static constexpr unsigned int guards = 2;
+
+    static constexpr double rate(ValveMode mode, double opening_time) {
+      return (mode == VALVE_IDLE ? 0.0 : (mode == VALVE_OPENING ? 1.0/opening_time : -1.0/opening_time));
+    }
+    // The guard of the forced e_idle transition of a moving valve, taken when not negative.
+    static constexpr double guard(ValveMode mode, double valvelevel) {
+      return (mode == VALVE_OPENING ? valvelevel - 1.0 : -valvelevel);
+    }
+  };
+
+  // A controller: no variables of its own, in the rising and falling modes, with a guard for each.
+  struct ControllerModel {
+    static constexpr unsigned int variables = 0;
+    static constexpr unsigned int modes = 2;
+    static constexpr unsigned int guards = 2;
+
+    // The guard of the forced e_close or e_open transition, taken when not negative.
+    static constexpr double guard(ControllerMode mode, double waterlevel, double hmin, double hmax) {
+      return (mode == CONTROLLER_RISING ? waterlevel - hmax : hmin - waterlevel);
+    }
+  };
+
+  // The largest binary tree whose vector field is compiled: each tree is a separate instantiation.
+  const unsigned int MAXIMUM_SPECIALISED_TANKS = 15;
+
+  /*
+  * A binary tree of tanks, with a valve and a controller for each tank, connected
+  * as in getBinaryTreeTopology. The state holds the water levels of all the tanks
+  * followed by the valve levels of all the valves.
+  */
+  template<unsigned int Tanks>
+  struct BinaryTreeModel {
+    static_assert(Tanks >= 1 && Tanks <= MAXIMUM_SPECIALISED_TANKS,
+                  "BinaryTreeModel is compiled for 1 to MAXIMUM_SPECIALISED_TANKS (15) tanks only; larger plants use the generic vector field.");
+    static constexpr unsigned int tanks = Tanks;
+    static constexpr unsigned int dimension = Tanks * (TankModel::variables + ValveModel::variables + ControllerModel::variables);
+    static constexpr unsigned int guards = Tanks * (ValveModel::guards + ControllerModel::guards);
+
+    // The position of a tank in heap order, the bottom tank being the root.
+    static constexpr unsigned int heap_index(unsigned int k) { return Tanks - 1 - k; }
+    static constexpr int downstream(unsigned int k) {
+      return (heap_index(k) == 0 ? -1 : (int)(Tanks - 1 - (heap_index(k) - 1) / 2));
+    }
+    static constexpr unsigned int upstream_count(unsigned int k) {
+      return (2*heap_index(k) + 1 < Tanks ? 1 : 0) + (2*heap_index(k) + 2 < Tanks ? 1 : 0);
+    }
+    static constexpr unsigned int upstream(unsigned int k, unsigned int i) {
+      return Tanks - 1 - (2*heap_index(k) + 1 + i);
+    }
+
+    // Whether the topology has this structure, whatever its parameters.
+    static bool matches(const PlantTopology& topology) {
+      if (topology.size() != Tanks)
+        return false;
+      for (unsigned int k = 0; k < Tanks; k++) {
+        if (topology.tanks[k].downstream != downstream(k))
+          return false;
+      }
+      return true;
+    }
+
+    // The vector field in the given valve modes, with the parameters of the topology.
+    static void derivative(const PlantTopology& parameters, const ValveMode* valves, const double* y, double* dy) {
+      for (unsigned int k = 0; k < Tanks; k++) {
+        const TankDescription& tank = parameters.tanks[k];
+        double inflow = 0.0;
+        if (upstream_count(k) == 0) {
+          inflow = TankModel::source_inflow(tank.input_flow,y[Tanks + k]);
+        } else {
+          for (unsigned int i = 0; i < upstream_count(k); i++)
+            inflow += TankModel::upper_inflow(parameters.tanks[upstream(k,i)].output_flow,y[Tanks + k],y[upstream(k,i)]);
+        }
+        double outflow = (downstream(k) < 0 ? TankModel::bottom_outflow(tank.output_flow,y[k])
+                                            : TankModel::lower_outflow(tank.output_flow,y[Tanks + downstream(k)],y[k]));
+        dy[k] = inflow - outflow;
+        dy[Tanks + k] = ValveModel::rate(valves[k],parameters.opening_time);
+      }
+    }
+  };
+
+  // The vector field of a plant of a fixed structure.
+  typedef void (*SpecialisedDerivative)(const PlantTopology&, const ValveMode*, const double*, double*);
+
+  // The specialised vector field of the binary trees of up to the given number of tanks.
+  template<unsigned int Tanks>
+  struct BinaryTreeModelTable {
+    static SpecialisedDerivative find(const PlantTopology& topology) {
+      if (BinaryTreeModel<Tanks>::matches(topology))
+        return &BinaryTreeModel<Tanks>::derivative;
+      return BinaryTreeModelTable<Tanks-1>::find(topology);
+    }
+  };
+
+  template<>
+  struct BinaryTreeModelTable<0> {
+    static SpecialisedDerivative find(const PlantTopology&) { return 0; }
+  };
+
+  /*
+  * The specialised vector field of a plant, if its structure is one of the binary
+  * trees instantiated, i.e. of up to MAXIMUM_SPECIALISED_TANKS tanks, otherwise a null pointer.
+  */
+  SpecialisedDerivative getSpecialisedDerivative(const PlantTopology& topology) {
+    return BinaryTreeModelTable<MAXIMUM_SPECIALISED_TANKS>::find(topology);
+  }
+
+}
+
+#endif
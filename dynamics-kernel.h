@@ -0,0 +1,227 @@
+/***************************************************************************
+*            dynamics-kernel.h
+*
+*  This file is used to describe a kernel evaluating the interval
+*  extension of the vector field of the plant over a batch of boxes.
+*  The boxes are stored as a structure of arrays, so that the same
+*  operation is applied to consecutive boxes; when the processor supports
+*  AVX2, four boxes are evaluated at a time. The lower bounds are computed
+*  rounding downwards and the upper bounds rounding upwards, hence the
+*  result encloses the derivative of every point of each box. A term which
+*  is subtracted is added with its operand negated, so that each bound is
+*  computed entirely in the rounding of its own pass.
+*  The dynamics are those of getSideTank, getMiddleTank, getBottomTank
+*  and getValve, for the plant given by a topology.
+*  The reachability analyser and the evolver of the library evaluate the
+*  vector field through its own expressions, hence the kernel does not
+*  make outer_chain_reach or epsilon_lower_chain_reach any faster: it
+*  serves the analyses which evaluate the dynamics over the reached cells
+*  themselves, such as the critical cells of the adaptive reaches.
+*  It depends on the standard library only.
+*
+*  Copyright  2018  Raffaello Corsini, Luca Geretti
+*
+****************************************************************************/
+
+/*
+*  This program is free software; you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation; either version 2 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Library General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program; if not, write to the Free Software
+*  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#ifndef DYNAMICS_KERNEL_H
+#define DYNAMICS_KERNEL_H
+
+#include <algorithm>
+#include <cfenv>
+#include <vector>
+#include "topology.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define WATERWORLD_HAS_AVX2_KERNEL 1
+#endif
+
+namespace Ariadne {
+
+  /*
+  * A batch of boxes as a structure of arrays: the bounds of variable i of
+  * box j are at index i*size()+j. The variables are the water levels of
+  * all the tanks followed by the valve levels of all the valves.
+  */
+  class BoxBatch {
+      unsigned int _dimension;
+      unsigned int _size;
+      std::vector<double> _lower;
+      std::vector<double> _upper;
+    public:
+      BoxBatch(unsigned int dimension, unsigned int size)
+        : _dimension(dimension), _size(size), _lower(dimension*size), _upper(dimension*size) { }
+      unsigned int dimension() const { return _dimension; }
+      unsigned int size() const { return _size; }
+      double* lower(unsigned int variable) { return &_lower[variable*_size]; }
+      double* upper(unsigned int variable) { return &_upper[variable*_size]; }
+      const double* lower(unsigned int variable) const { return &_lower[variable*_size]; }
+      const double* upper(unsigned int variable) const { return &_upper[variable*_size]; }
+  };
+
+  class DynamicsKernel {
+
+      PlantTopology _topology;
+      unsigned int _n;
+      std::vector< std::vector<unsigned int> > _upstream;
+      bool _use_avx2;
+
+      // The direction of rounding of a pass: the lower bounds take the minimum of the
+      // products rounded downwards, the upper bounds the maximum rounded upwards.
+      enum Bound { LOWER, UPPER };
+      // The sign of a term in the derivative.
+      enum Sign { ADDED, SUBTRACTED };
+
+    public:
+
+      DynamicsKernel(const PlantTopology& topology) : _topology(topology), _n(topology.size()), _use_avx2(false) {
+        _topology.check();
+        for (unsigned int k = 0; k < _n; k++)
+          _upstream.push_back(_topology.upstream(k));
+#ifdef WATERWORLD_HAS_AVX2_KERNEL
+        _use_avx2 = __builtin_cpu_supports("avx2");
+#endif
+      }
+
+      // Whether the batches are evaluated four boxes at a time.
+      bool uses_avx2() const { return _use_avx2; }
+      void set_use_avx2(bool use) {
+#ifdef WATERWORLD_HAS_AVX2_KERNEL
+        _use_avx2 = use && __builtin_cpu_supports("avx2");
+#endif
+      }
+
+      /*
+      * Encloses the derivatives over the boxes of the batch, with the valves in the
+      * given modes, e.g. the ones of a location of the composed system.
+      */
+      void evaluate(const std::vector<ValveMode>& valves, const BoxBatch& boxes, BoxBatch& derivatives) const {
+        int rounding = std::fegetround();
+        std::fesetround(FE_DOWNWARD);
+        _evaluate(LOWER,valves,boxes,derivatives);
+        std::fesetround(FE_UPWARD);
+        _evaluate(UPPER,valves,boxes,derivatives);
+        std::fesetround(rounding);
+      }
+
+    private:
+
+      void _evaluate(Bound bound, const std::vector<ValveMode>& valves, const BoxBatch& boxes, BoxBatch& derivatives) const {
+        unsigned int size = boxes.size();
+        std::vector<double> inflow(size), outflow(size), product(size);
+
+        for (unsigned int k = 0; k < _n; k++) {
+          const TankDescription& tank = _topology.tanks[k];
+          const unsigned int valve = _n + k;
+
+          // What comes in: from the constant input, or from the upper tanks
+          std::fill(inflow.begin(),inflow.end(),0.0);
+          if (_upstream[k].empty()) {
+            _scale(bound,ADDED,tank.input_flow,boxes.lower(valve),boxes.upper(valve),size,inflow.data());
+          } else {
+            for (unsigned int i = 0; i < _upstream[k].size(); i++) {
+              unsigned int u = _upstream[k][i];
+              _product(bound,ADDED,0.5*_topology.tanks[u].output_flow,boxes,valve,u,size,product.data());
+              for (unsigned int j = 0; j < size; j++)
+                inflow[j] += product[j];
+            }
+          }
+
+          // What goes out, towards the lower tank or from the bottom, as the bound of its opposite
+          if (tank.downstream < 0)
+            _scale(bound,SUBTRACTED,tank.output_flow,boxes.lower(k),boxes.upper(k),size,outflow.data());
+          else
+            _product(bound,SUBTRACTED,0.5*tank.output_flow,boxes,_n + tank.downstream,k,size,outflow.data());
+
+          double* result = (bound == LOWER ? derivatives.lower(k) : derivatives.upper(k));
+          for (unsigned int j = 0; j < size; j++)
+            result[j] = inflow[j] + outflow[j];
+
+          // The valve moves at a constant rate
+          double rate = (valves[k] == VALVE_IDLE ? 0.0 : (valves[k] == VALVE_OPENING ? 1.0 : -1.0) / _topology.opening_time);
+          double* valve_result = (bound == LOWER ? derivatives.lower(valve) : derivatives.upper(valve));
+          std::fill(valve_result,valve_result + size,rate);
+        }
+      }
+
+      // The bound of c*[lower,upper], or of -c*[lower,upper], for a non-negative constant c.
+      // The interval is negated before the product, which is exact.
+      static void _scale(Bound bound, Sign sign, double c, const double* lower, const double* upper, unsigned int size, double* result) {
+        if (sign == ADDED) {
+          const double* source = (bound == LOWER ? lower : upper);
+          for (unsigned int j = 0; j < size; j++)
+            result[j] = c * source[j];
+        } else {
+          const double* source = (bound == LOWER ? upper : lower);
+          for (unsigned int j = 0; j < size; j++)
+            result[j] = c * (-source[j]);
+        }
+      }
+
+      /*
+      * The bound of c*A*B, or of c*(-A)*B, for a non-negative constant c and the variables a and b of the boxes.
+      * The bound of A*B is taken first, over the products of the bounds rounded in the direction of the pass,
+      * then it is scaled by c, which keeps the direction since c is not negative: this holds whatever the
+      * signs of A and B, unlike scaling the bounds of A first.
+      */
+      void _product(Bound bound, Sign sign, double c, const BoxBatch& boxes, unsigned int a, unsigned int b, unsigned int size, double* result) const {
+        const double* al = boxes.lower(a);
+        const double* au = boxes.upper(a);
+        const double* bl = boxes.lower(b);
+        const double* bu = boxes.upper(b);
+        double s = (sign == ADDED ? 1.0 : -1.0);
+        unsigned int j = 0;
+#ifdef WATERWORLD_HAS_AVX2_KERNEL
+        if (_use_avx2)
+          j = _product_avx2(bound,s,c,al,au,bl,bu,size,result);
+#endif
+        for (; j < size; j++) {
+          double p1 = s*al[j], p2 = s*au[j];
+          double q1 = p1*bl[j], q2 = p1*bu[j], q3 = p2*bl[j], q4 = p2*bu[j];
+          result[j] = c * (bound == LOWER ? std::min(std::min(q1,q2),std::min(q3,q4)) : std::max(std::max(q1,q2),std::max(q3,q4)));
+        }
+      }
+
+#ifdef WATERWORLD_HAS_AVX2_KERNEL
+      // Four boxes at a time, returning the number of boxes done.
+      __attribute__((target("avx2")))
+      static unsigned int _product_avx2(Bound bound, double s, double c, const double* al, const double* au, const double* bl, const double* bu,
+          unsigned int size, double* result) {
+        __m256d vs = _mm256_set1_pd(s);
+        __m256d vc = _mm256_set1_pd(c);
+        unsigned int j = 0;
+        for (; j + 4 <= size; j += 4) {
+          __m256d p1 = _mm256_mul_pd(vs,_mm256_loadu_pd(al + j));
+          __m256d p2 = _mm256_mul_pd(vs,_mm256_loadu_pd(au + j));
+          __m256d vbl = _mm256_loadu_pd(bl + j);
+          __m256d vbu = _mm256_loadu_pd(bu + j);
+          __m256d q1 = _mm256_mul_pd(p1,vbl), q2 = _mm256_mul_pd(p1,vbu);
+          __m256d q3 = _mm256_mul_pd(p2,vbl), q4 = _mm256_mul_pd(p2,vbu);
+          __m256d r = (bound == LOWER ? _mm256_min_pd(_mm256_min_pd(q1,q2),_mm256_min_pd(q3,q4))
+                                      : _mm256_max_pd(_mm256_max_pd(q1,q2),_mm256_max_pd(q3,q4)));
+          _mm256_storeu_pd(result + j,_mm256_mul_pd(vc,r));
+        }
+        return j;
+      }
+#endif
+  };
+
+}
+
+#endif
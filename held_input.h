@@ -0,0 +1,54 @@
+/***************************************************************************
+*            held_input.h
+*
+*  This file is used to describe an input held constant, i.e. a variable
+*  produced outside of a subsystem, whose value is kept fixed at any value
+*  of an assumed interval. It replaces the component producing such
+*  variable when a subsystem is analysed on its own.
+*
+*  Copyright  2018  Raffaello Corsini, Luca Geretti
+*
+****************************************************************************/
+
+/*
+*  This program is free software; you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation; either version 2 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Library General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program; if not, write to the Free Software
+*  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#include <ariadne.h>
+
+namespace Ariadne {
+
+  HybridIOAutomaton getHeldInput(
+    // The variable produced outside of the subsystem.
+    RealVariable input){
+
+      // 1. Automaton
+      HybridIOAutomaton held("held_" + input.name());
+
+      // 2. Registration of the output variable
+      held.add_output_var(input);
+
+      // 3. Registration of the location
+      DiscreteLocation hold("hold_" + input.name());
+      held.new_mode(hold);
+
+      // 4. Registration of the dynamics: the value never changes
+      held.set_dynamics(hold, input, 0.0);
+
+      return held;
+
+    }
+
+  }
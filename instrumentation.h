@@ -0,0 +1,198 @@
+/***************************************************************************
+*            instrumentation.h
+*
+*  This file is used to describe a profiler for the analyses. It collects
+*  counters, keyed by analysis stage, discrete location and metric, and
+*  timed spans of the work done. At the end of a run they can be written
+*  as JSON, or as a trace to be opened with chrome://tracing.
+*  The profiler is disabled by default, in which case it records nothing.
+*  It depends on the standard library only.
+*
+*  Copyright  2018  Raffaello Corsini, Luca Geretti
+*
+****************************************************************************/
+
+/*
+*  This program is free software; you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation; either version 2 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Library General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program; if not, write to the Free Software
+*  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#ifndef INSTRUMENTATION_H
+#define INSTRUMENTATION_H
+
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+namespace Ariadne {
+
+  class Profiler {
+
+    public:
+
+      typedef std::chrono::steady_clock Clock;
+
+      // A timed span of work.
+      struct Span {
+        std::string stage;
+        std::string name;
+        double start;
+        double duration;
+        unsigned int thread;
+      };
+
+    private:
+
+      bool _enabled;
+      Clock::time_point _origin;
+      std::mutex _lock;
+      // The counters, keyed by stage, location and metric.
+      std::map< std::tuple<std::string,std::string,std::string>, unsigned long > _counters;
+      std::vector<Span> _spans;
+      std::map<std::thread::id,unsigned int> _threads;
+
+      static std::string& _current_stage() {
+        static thread_local std::string stage;
+        return stage;
+      }
+
+      static std::string _escape(const std::string& text) {
+        std::string result;
+        for (unsigned int i = 0; i < text.size(); i++) {
+          if (text[i] == '"' || text[i] == '\\')
+            result += '\\';
+          result += text[i];
+        }
+        return result;
+      }
+
+    public:
+
+      Profiler() : _enabled(false), _origin(Clock::now()) { }
+
+      bool enabled() const { return _enabled; }
+      void set_enabled(bool enabled) { _enabled = enabled; }
+
+      // The stage the calling thread is working for.
+      std::string stage() const { return _current_stage(); }
+
+      // Sets the stage of the calling thread while in scope.
+      class StageScope {
+          std::string _previous;
+        public:
+          StageScope(const std::string& stage) : _previous(_current_stage()) { _current_stage() = stage; }
+          ~StageScope() { _current_stage() = _previous; }
+      };
+
+      // Adds to a counter of the given stage and location.
+      void count(const std::string& stage, const std::string& location, const std::string& metric, unsigned long value = 1) {
+        if (!_enabled)
+          return;
+        std::lock_guard<std::mutex> guard(_lock);
+        _counters[std::make_tuple(stage,location,metric)] += value;
+      }
+
+      // Adds to a counter of the stage of the calling thread.
+      void count(const std::string& location, const std::string& metric, unsigned long value = 1) {
+        count(stage(),location,metric,value);
+      }
+
+      // Measures the time spent in its scope, for the given stage.
+      class Timer {
+          Profiler& _profiler;
+          std::string _stage;
+          std::string _name;
+          Clock::time_point _start;
+        public:
+          Timer(Profiler& profiler, const std::string& name)
+            : _profiler(profiler), _stage(profiler.stage()), _name(name), _start(Clock::now()) { }
+          Timer(Profiler& profiler, const std::string& stage, const std::string& name)
+            : _profiler(profiler), _stage(stage), _name(name), _start(Clock::now()) { }
+          ~Timer() { _profiler._record(_stage,_name,_start,Clock::now()); }
+      };
+
+      // Writes the counters, along with the total time and calls of each span, as JSON.
+      void write_json(const std::string& filename) {
+        std::lock_guard<std::mutex> guard(_lock);
+        std::map< std::pair<std::string,std::string>, std::pair<unsigned long,double> > totals;
+        for (unsigned int i = 0; i < _spans.size(); i++) {
+          std::pair<unsigned long,double>& total = totals[std::make_pair(_spans[i].stage,_spans[i].name)];
+          total.first++;
+          total.second += _spans[i].duration;
+        }
+        std::ofstream json(filename.c_str());
+        json << "{\n  \"counters\": [";
+        bool first = true;
+        for (std::map< std::tuple<std::string,std::string,std::string>, unsigned long >::const_iterator it = _counters.begin(); it != _counters.end(); ++it) {
+          json << (first ? "\n" : ",\n") << "    {\"stage\": \"" << _escape(std::get<0>(it->first))
+               << "\", \"location\": \"" << _escape(std::get<1>(it->first))
+               << "\", \"metric\": \"" << _escape(std::get<2>(it->first))
+               << "\", \"value\": " << it->second << "}";
+          first = false;
+        }
+        json << "\n  ],\n  \"timers\": [";
+        first = true;
+        for (std::map< std::pair<std::string,std::string>, std::pair<unsigned long,double> >::const_iterator it = totals.begin(); it != totals.end(); ++it) {
+          json << (first ? "\n" : ",\n") << "    {\"stage\": \"" << _escape(it->first.first)
+               << "\", \"name\": \"" << _escape(it->first.second)
+               << "\", \"calls\": " << it->second.first << ", \"total_s\": " << it->second.second << "}";
+          first = false;
+        }
+        json << "\n  ]\n}\n";
+      }
+
+      // Writes the spans in the Chrome trace event format, one row per thread.
+      void write_chrome_trace(const std::string& filename) {
+        std::lock_guard<std::mutex> guard(_lock);
+        std::ofstream trace(filename.c_str());
+        trace << "{\"traceEvents\": [";
+        for (unsigned int i = 0; i < _spans.size(); i++) {
+          const Span& span = _spans[i];
+          trace << (i == 0 ? "\n" : ",\n") << "  {\"name\": \"" << _escape(span.name) << "\", \"cat\": \"" << _escape(span.stage)
+                << "\", \"ph\": \"X\", \"ts\": " << (long long)(span.start * 1e6) << ", \"dur\": " << (long long)(span.duration * 1e6)
+                << ", \"pid\": 1, \"tid\": " << span.thread << "}";
+        }
+        trace << "\n]}\n";
+      }
+
+    private:
+
+      void _record(const std::string& stage, const std::string& name, Clock::time_point start, Clock::time_point end) {
+        if (!_enabled)
+          return;
+        std::lock_guard<std::mutex> guard(_lock);
+        std::map<std::thread::id,unsigned int>::const_iterator it = _threads.find(std::this_thread::get_id());
+        unsigned int thread = _threads.size();
+        if (it != _threads.end())
+          thread = it->second;
+        else
+          _threads[std::this_thread::get_id()] = thread;
+        Span span = { stage, name,
+                      std::chrono::duration<double>(start - _origin).count(),
+                      std::chrono::duration<double>(end - start).count(), thread };
+        _spans.push_back(span);
+      }
+  };
+
+  // The profiler of the analyses.
+  Profiler profiler;
+
+}
+
+#endif
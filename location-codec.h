@@ -0,0 +1,191 @@
+/***************************************************************************
+*            location-codec.h
+*
+*  This file is used to describe the encoding of the locations of the
+*  composed system as integers. A location of the composition is a tuple
+*  of the modes of its components, named by joining the names of the modes,
+*  e.g. "flow0,flow1,flow2,idle_0,idle_1,idle_2,rising0,rising1,rising2":
+*  since the tanks have a single mode, a location is given by the mode of
+*  each valve (idle, opening, closing) and of each controller (rising,
+*  falling), i.e. by a number in mixed radix, with a digit in 0..5 for each
+*  tank. The number is split into 64-bit words of 24 digits each, hence any
+*  number of tanks is encoded. Codes are compared as integers, and the modes
+*  of a component are read in constant time, while the names are produced
+*  only for output. The code 0 is the initial location of getInitialLocation.
+*  It depends on the standard library only.
+*
+*  Copyright  2018  Raffaello Corsini, Luca Geretti
+*
+****************************************************************************/
+
+/*
+*  This program is free software; you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation; either version 2 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Library General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program; if not, write to the Free Software
+*  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#ifndef LOCATION_CODEC_H
+#define LOCATION_CODEC_H
+
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "topology.h"
+
+namespace Ariadne {
+
+  // The code of a location of the composed system, as words of digits, the least significant first.
+  // Codes are compared word by word, hence only the codes of plants with the same tanks are comparable.
+  class LocationCode {
+
+    public:
+
+      std::vector<uint64_t> words;
+
+      LocationCode() { }
+      explicit LocationCode(unsigned int size) : words(size,0) { }
+
+      bool operator==(const LocationCode& other) const { return words == other.words; }
+      bool operator!=(const LocationCode& other) const { return words != other.words; }
+      bool operator<(const LocationCode& other) const { return words < other.words; }
+
+      // Adds the digits of the code of other components, which are zero in this code
+      LocationCode& operator+=(const LocationCode& other) {
+        for (unsigned int i = 0; i < words.size() && i < other.words.size(); i++)
+          words[i] += other.words[i];
+        return *this;
+      }
+  };
+
+  class LocationCodec {
+
+      unsigned int _tanks;
+      // The number of words of a code.
+      unsigned int _words;
+      // The weight of the digit of each tank within its word.
+      std::vector<uint64_t> _weights;
+
+    public:
+
+      // The number of modes of the valve and of the controller of a tank, i.e. the radix of its digit.
+      static const unsigned int TANK_RADIX = 6;
+      // The number of digits in a word, i.e. the largest power of the radix below 2^64.
+      static const unsigned int TANKS_PER_WORD = 24;
+
+      LocationCodec(unsigned int tanks) : _tanks(tanks), _words((tanks + TANKS_PER_WORD - 1) / TANKS_PER_WORD),
+                                          _weights(tanks < TANKS_PER_WORD ? tanks : TANKS_PER_WORD) {
+        uint64_t weight = 1;
+        for (unsigned int k = 0; k < _weights.size(); k++, weight *= TANK_RADIX)
+          _weights[k] = weight;
+      }
+
+      unsigned int tanks() const { return _tanks; }
+
+      // The code of the initial location, where every valve is idle and every controller is rising.
+      LocationCode initial() const { return LocationCode(_words); }
+
+      ValveMode valve(const LocationCode& code, unsigned int k) const {
+        return (ValveMode)(_digit(code,k) % 3);
+      }
+
+      ControllerMode controller(const LocationCode& code, unsigned int k) const {
+        return (ControllerMode)(_digit(code,k) / 3);
+      }
+
+      LocationCode encode(const std::vector<ValveMode>& valves, const std::vector<ControllerMode>& controllers) const {
+        LocationCode code(_words);
+        for (unsigned int k = 0; k < _tanks; k++)
+          code.words[k / TANKS_PER_WORD] += (valves[k] + 3 * controllers[k]) * _weights[k % TANKS_PER_WORD];
+        return code;
+      }
+
+      void decode(const LocationCode& code, std::vector<ValveMode>& valves, std::vector<ControllerMode>& controllers) const {
+        valves.resize(_tanks);
+        controllers.resize(_tanks);
+        for (unsigned int k = 0; k < _tanks; k++) {
+          valves[k] = valve(code,k);
+          controllers[k] = controller(code,k);
+        }
+      }
+
+      // The name of the mode of the valve or of the controller of a tank, as in the composed names.
+      static std::string valve_name(ValveMode mode, unsigned int k) {
+        return (mode == VALVE_IDLE ? "idle_" : (mode == VALVE_OPENING ? "opening_" : "closing_")) + std::to_string(k);
+      }
+      static std::string controller_name(ControllerMode mode, unsigned int k) {
+        return (mode == CONTROLLER_RISING ? "rising" : "falling") + std::to_string(k);
+      }
+
+      // The name of the location, with the components in the order of the composition of the system.
+      std::string name(const LocationCode& code) const {
+        std::string result;
+        for (unsigned int k = 0; k < _tanks; k++)
+          result += "flow" + std::to_string(k) + ",";
+        for (unsigned int k = 0; k < _tanks; k++)
+          result += valve_name(valve(code,k),k) + ",";
+        for (unsigned int k = 0; k < _tanks; k++)
+          result += controller_name(controller(code,k),k) + (k + 1 < _tanks ? "," : "");
+        return result;
+      }
+
+      /*
+      * Reads the code of a location from its name, whatever the order of the components;
+      * returns false if the name has a component which is not a mode of this plant, e.g.
+      * for a location of a partial composition, leaving the code undefined.
+      */
+      bool parse(const std::string& name, LocationCode& code) const {
+        code = LocationCode(_words);
+        size_t start = 0;
+        while (start <= name.size()) {
+          size_t end = name.find(',',start);
+          if (end == std::string::npos)
+            end = name.size();
+          if (!_parse_component(name.substr(start,end-start),code))
+            return false;
+          start = end + 1;
+        }
+        return true;
+      }
+
+    private:
+
+      unsigned int _digit(const LocationCode& code, unsigned int k) const {
+        return (code.words[k / TANKS_PER_WORD] / _weights[k % TANKS_PER_WORD]) % TANK_RADIX;
+      }
+
+      // Adds the mode of a single component to the code, if it is a mode of the plant.
+      bool _parse_component(const std::string& component, LocationCode& code) const {
+        static const char* prefixes[] = { "flow", "idle_", "opening_", "closing_", "rising", "falling" };
+        for (unsigned int p = 0; p < 6; p++) {
+          size_t length = std::char_traits<char>::length(prefixes[p]);
+          if (component.compare(0,length,prefixes[p]) != 0 || component.size() == length)
+            continue;
+          char* end;
+          unsigned long k = std::strtoul(component.c_str() + length,&end,10);
+          if (*end != '\0' || k >= _tanks)
+            return false;
+          uint64_t& word = code.words[k / TANKS_PER_WORD];
+          if (p >= 1 && p <= 3)
+            word += (p - 1) * _weights[k % TANKS_PER_WORD];
+          else if (p == 5)
+            word += 3 * _weights[k % TANKS_PER_WORD];
+          return true;
+        }
+        return false;
+      }
+  };
+
+}
+
+#endif
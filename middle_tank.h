@@ -0,0 +1,77 @@
+/***************************************************************************
+*            middle_tank.h
+*
+*  This file is used to describe a middle_tank of a tree of watertanks.
+*  It takes as inputs the flows from its upper tanks and its output
+*  flows into a lower tank.
+*
+*  Copyright  2018  Raffaello Corsini, Luca Geretti
+*
+****************************************************************************/
+
+/*
+*  This program is free software; you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation; either version 2 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Library General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program; if not, write to the Free Software
+*  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#include <ariadne.h>
+
+namespace Ariadne {
+
+  /*
+  * Function returning the desired automata. It takes in input the waterlevel,
+  * the upper_waterlevels, the upper_valvelevel, the lower_valvelevel,
+  * the upper_output_flows and its internal_output_flow.
+  */
+  HybridIOAutomaton getMiddleTank(
+    RealVariable internal_waterlevel,
+    std::vector<RealVariable> upper_waterlevels,
+    RealVariable upper_valvelevel,
+    RealVariable lower_valvelevel,
+    std::vector<RealParameter> upper_output_flows,
+    RealParameter lower_output_flow,
+    int progressive){
+
+      // Conversion of the progressive integer to a String.
+      String number = Ariadne::to_string(progressive);
+
+      // Creation of the automaton, with a progressive label.
+      HybridIOAutomaton tank("tank" + number);
+
+      // Adding the input/output vars.
+      tank.add_input_var(upper_valvelevel);
+      for (unsigned int k = 0; k < upper_waterlevels.size(); k++){
+        tank.add_input_var(upper_waterlevels.at(k));
+      }
+      tank.add_output_var(internal_waterlevel);
+
+      // Creation of the location.
+      DiscreteLocation middle_tank_flow("flow" + number);
+      // Adding the location to the automaton.
+      tank.new_mode(middle_tank_flow);
+
+      // What goes out, towards the lower tank.
+      RealExpression dynamics = - lower_output_flow * ( lower_valvelevel / 2 ) * internal_waterlevel;
+      // What comes in from each upper tank.
+      for (unsigned int k = 0; k < upper_waterlevels.size(); k++){
+        dynamics = dynamics + upper_output_flows.at(k) * ( upper_valvelevel / 2 ) * upper_waterlevels.at(k);
+      }
+
+      // Setting the dynamics
+      tank.set_dynamics(middle_tank_flow, internal_waterlevel, dynamics);
+
+        return tank;
+      }
+
+    }
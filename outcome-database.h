@@ -0,0 +1,140 @@
+/***************************************************************************
+*            outcome-database.h
+*
+*  This file is used to describe an on-disk database of the outcomes of
+*  the parametric safety verification. Each outcome is stored along with
+*  its box of parameters and a context, i.e. a key identifying the
+*  system, the initial set, the specification and the settings of the
+*  verification: outcomes are reused only within the same context.
+*  A box found safe makes all its sub-boxes safe too, while a box found
+*  unsafe says nothing about its sub-boxes, hence it is reused only for
+*  the same box. Undecided boxes are stored but never reused.
+*
+*  The file is made of text lines, appended as outcomes are found:
+*  <context> <outcome> <parameter> <lower> <upper> [<parameter> ...]
+*  where the outcome is 1 for safe, 0 for unsafe, -1 for undecided.
+*  It depends on the standard library only.
+*
+*  Copyright  2018  Raffaello Corsini, Luca Geretti
+*
+****************************************************************************/
+
+/*
+*  This program is free software; you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation; either version 2 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Library General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program; if not, write to the Free Software
+*  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#ifndef OUTCOME_DATABASE_H
+#define OUTCOME_DATABASE_H
+
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace Ariadne {
+
+  enum StoredOutcome { OUTCOME_UNDECIDED = -1, OUTCOME_UNSAFE = 0, OUTCOME_SAFE = 1 };
+
+  // A box of parameters, as the names of the parameters along with their bounds.
+  struct StoredBox {
+    std::vector<std::string> names;
+    std::vector<double> lower;
+    std::vector<double> upper;
+
+    // Whether this box is contained in the other one, which must have the same parameters.
+    bool subset(const StoredBox& other) const {
+      if (names != other.names)
+        return false;
+      for (unsigned int i = 0; i < names.size(); i++) {
+        if (lower[i] < other.lower[i] || upper[i] > other.upper[i])
+          return false;
+      }
+      return true;
+    }
+
+    bool operator==(const StoredBox& other) const {
+      return names == other.names && lower == other.lower && upper == other.upper;
+    }
+  };
+
+  class OutcomeDatabase {
+
+      std::string _filename;
+      std::mutex _lock;
+      // The outcomes of each context, in the order they were stored.
+      std::map< std::string, std::vector< std::pair<StoredBox,StoredOutcome> > > _outcomes;
+
+    public:
+
+      // Opens the database in the given file, loading the outcomes already there, if any.
+      OutcomeDatabase(const std::string& filename) : _filename(filename) {
+        std::ifstream file(filename.c_str());
+        std::string line;
+        while (std::getline(file,line)) {
+          std::istringstream fields(line);
+          std::string context;
+          int outcome;
+          if (!(fields >> context >> outcome))
+            continue;
+          StoredBox box;
+          std::string name;
+          double lower, upper;
+          while (fields >> name >> lower >> upper) {
+            box.names.push_back(name);
+            box.lower.push_back(lower);
+            box.upper.push_back(upper);
+          }
+          _outcomes[context].push_back(std::make_pair(box,(StoredOutcome)outcome));
+        }
+      }
+
+      /*
+      * The outcome known for a box in the given context: safe if a box containing it was
+      * found safe, unsafe if the same box was found unsafe, otherwise undecided.
+      */
+      StoredOutcome lookup(const std::string& context, const StoredBox& box) {
+        std::lock_guard<std::mutex> guard(_lock);
+        std::map< std::string, std::vector< std::pair<StoredBox,StoredOutcome> > >::const_iterator it = _outcomes.find(context);
+        if (it == _outcomes.end())
+          return OUTCOME_UNDECIDED;
+        StoredOutcome result = OUTCOME_UNDECIDED;
+        for (unsigned int i = 0; i < it->second.size(); i++) {
+          const std::pair<StoredBox,StoredOutcome>& stored = it->second[i];
+          if (stored.second == OUTCOME_SAFE && box.subset(stored.first))
+            return OUTCOME_SAFE;
+          if (stored.second == OUTCOME_UNSAFE && box == stored.first)
+            result = OUTCOME_UNSAFE;
+        }
+        return result;
+      }
+
+      // Stores the outcome of a box in the given context, appending it to the file at once.
+      void store(const std::string& context, const StoredBox& box, StoredOutcome outcome) {
+        std::lock_guard<std::mutex> guard(_lock);
+        _outcomes[context].push_back(std::make_pair(box,outcome));
+        std::ofstream file(_filename.c_str(),std::ios::app);
+        file.precision(17);
+        file << context << " " << (int)outcome;
+        for (unsigned int i = 0; i < box.names.size(); i++)
+          file << " " << box.names[i] << " " << box.lower[i] << " " << box.upper[i];
+        file << "\n";
+      }
+  };
+
+}
+
+#endif
@@ -4,6 +4,10 @@
 *  The main file of the project.
 *  It creates the automata, initializes it and performs the analysis.
 *
+*  Usage: project [verbosity] [parallel] [tanks] [stream prefix] [profile prefix]
+*                 [warm start prefix] [outcome database] [delta]
+*  The arguments are checked, and -h or --help prints their meaning.
+*
 *  Copyright  2018  Raffaello Corsini, Luca Geretti
 *
 ****************************************************************************/
@@ -27,20 +31,90 @@
 #include <ariadne.h> // Library header
 #include "system.h" // System definition
 #include "analysis.h" // Custom analysis routines to be run
+#include "arguments.h" // Checked reading of the arguments
+
+// Prints the usage, with the error which led to it if any, returning the exit status
+int usage(const char* program, const std::string& error) {
+  std::ostream& out = (error.empty() ? std::cout : std::cerr);
+  if (!error.empty())
+    out << program << ": " << error << std::endl;
+  out << "Usage: " << program << " [verbosity] [parallel] [tanks] [stream prefix] [profile prefix]" << std::endl
+      << "         [warm start prefix] [outcome database] [delta]" << std::endl
+      << "  verbosity          the verbosity of the library, not negative (default 0)" << std::endl
+      << "  parallel           1 to run the analyses in parallel, 0 not to (default 0)" << std::endl
+      << "  tanks              the tanks of a binary tree, at least 2 (default the original plant of 3)" << std::endl
+      << "  stream prefix      the prefix of the streams of the reached sets, instead of plots" << std::endl
+      << "  profile prefix     the prefix of the profile of the analyses" << std::endl
+      << "  warm start prefix  the prefix of the reached sets saved for later runs" << std::endl
+      << "  outcome database   the file of the outcomes of the parametric verification" << std::endl
+      << "  delta              'delta' for the controllers switching within delta, 'urgent' otherwise (default)" << std::endl;
+  return (error.empty() ? 0 : 1);
+}
 
 int main(int argc,char *argv[])
 {
+  if (help_requested(argc,argv))
+    return usage(argv[0],"");
+  if (argc > 9)
+    return usage(argv[0],"too many arguments.");
+
   // This snippet reads, from the first argument of the executable, the verbosity value to be used
-  int verb = 0;
-  if (argc > 1)
-  verb = atoi(argv[1]);
+  long verbosity_argument = 0;
+  if (argc > 1 && !parse_integer(argv[1],0,1000,verbosity_argument))
+    return usage(argv[0],"the verbosity must be a whole number not negative, not '" + std::string(argv[1]) + "'.");
+  int verb = verbosity_argument;
+
+  // The second argument, if non-zero, runs the analyses in parallel, each one on its own system
+  long parallel_argument = 0;
+  if (argc > 2 && !parse_integer(argv[2],0,1,parallel_argument))
+    return usage(argv[0],"the parallel flag must be 0 or 1, not '" + std::string(argv[2]) + "'.");
+  bool parallel = (parallel_argument != 0);
 
   // Instructs not to produce any plot results.
   // Set this to true to create plots within a folder named 'tutorial-png' in the current working director
   bool plot_results = true;
 
-  // Loads the system from the system.h file
-  HybridIOAutomaton system = Ariadne::getSystem();
+  // The third argument, if given, is the number of tanks of a binary tree of tanks.
+  // Otherwise the plant is the original one, with two side tanks over a bottom tank.
+  PlantTopology topology = getPyramidTopology();
+  if (argc > 3) {
+    long tanks;
+    if (!parse_integer(argv[3],2,100000,tanks))
+      return usage(argv[0],"the tanks must be a whole number of at least 2, not '" + std::string(argv[3]) + "'.");
+    topology = getBinaryTreeTopology(tanks);
+  }
+
+  // The fourth argument, if given, is the prefix of the files where the reached sets are streamed,
+  // to be rendered offline with reach-render, instead of being plotted
+  if (argc > 4)
+  analysis_settings.stream_prefix = argv[4];
+
+  // The fifth argument, if given, is the prefix of the files where the profile of the analyses is written
+  if (argc > 5)
+  analysis_settings.profile_prefix = argv[5];
+  profiler.set_enabled(!analysis_settings.profile_prefix.empty());
+
+  // The sixth argument, if given, is the prefix of the files where the outer and epsilon-lower reached
+  // sets are saved; if they are there from an earlier run, the analyses start from them
+  if (argc > 6)
+  analysis_settings.warm_start_prefix = argv[6];
+
+  // The seventh argument, if given, is the file of the database of the parametric outcomes,
+  // so that the boxes decided by an earlier run are not verified again
+  if (argc > 7)
+  analysis_settings.outcome_database = argv[7];
+
+  // The eighth argument, if "delta", builds the controllers which switch anywhere within delta of their
+  // thresholds instead of the urgent ones
+  if (argc > 8) {
+    if (String(argv[8]) != "delta" && String(argv[8]) != "urgent")
+      return usage(argv[0],"the controllers must be 'delta' or 'urgent', not '" + std::string(argv[8]) + "'.");
+    topology.urgent_controllers = (String(argv[8]) != "delta");
+  }
+
+  // Loads the system from the system.h file; the workers of the parallel analyses build their own
+  analysed_topology = topology;
+  HybridIOAutomaton system = Ariadne::getSystem(topology,verb);
 
   // Constructs an initial state, in particular from two different locations of the system
   // Please note how the system variables are ordered alphabetically: this is important to
@@ -48,10 +122,20 @@ int main(int argc,char *argv[])
   HybridBoundedConstraintSet initial_set(system.state_space());
 
   // Construction of the initial state from a location of the automaton.
-  initial_set[DiscreteLocation("flow0,flow1,flow2,idle_0,idle_1,idle_2,rising0,rising1,rising2")]
+  // For the original plant this is "flow0,flow1,flow2,idle_0,idle_1,idle_2,rising0,rising1,rising2".
+  initial_set[getInitialLocation(topology)]
   // The variables' alphabetic order is valveLevel 0-1-2, waterLevel 0-1-2.
-  = Box(6, 1.0,1.0 , 1.0,1.0 , 1.0,1.0 , 7.0,7.0 , 7.0,7.0 , 7.0,7.0);
+  = getTankBox(topology.size(), Interval(1.0,1.0), Interval(7.0,7.0));
 
   // Runs the analysis routines set in the analysis.h file
+  if (parallel)
+  analyse_in_parallel(initial_set,verb,plot_results);
+  else
   analyse(system,initial_set,verb,plot_results);
+
+  // Writes the counters and the timers collected during the analyses
+  if (profiler.enabled()) {
+    profiler.write_json(analysis_settings.profile_prefix + ".json");
+    profiler.write_chrome_trace(analysis_settings.profile_prefix + ".trace.json");
+  }
 }
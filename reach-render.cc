@@ -0,0 +1,105 @@
+/***************************************************************************
+*            reach-render.cc
+*
+*  Renders a reach stream written by the analyses, projected on two of its
+*  dimensions, as an SVG image. Each location gets its own colour.
+*  It does not need the library, so it can run on any machine.
+*
+*  Usage: reach-render <stream> <x dimension> <y dimension> <output.svg>
+*
+*  Copyright  2018  Raffaello Corsini, Luca Geretti
+*
+****************************************************************************/
+
+/*
+*  This program is free software; you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation; either version 2 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Library General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program; if not, write to the Free Software
+*  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include "reach-stream.h"
+
+using namespace Ariadne;
+
+int main(int argc,char *argv[])
+{
+  if (argc < 5) {
+    std::cerr << "Usage: " << argv[0] << " <stream> <x dimension> <y dimension> <output.svg>" << std::endl;
+    return 1;
+  }
+
+  unsigned int x = atoi(argv[2]);
+  unsigned int y = atoi(argv[3]);
+
+  try {
+    // First pass: the bounding box of the projection and the locations.
+    double xmin = std::numeric_limits<double>::max(), xmax = -xmin;
+    double ymin = xmin, ymax = -xmin;
+    std::map<std::string,unsigned int> locations;
+    unsigned long boxes = 0;
+    {
+      ReachStreamReader reader(argv[1]);
+      if (x >= reader.dimension() || y >= reader.dimension()) {
+        std::cerr << "The stream has only " << reader.dimension() << " dimensions." << std::endl;
+        return 1;
+      }
+      ReachBox box;
+      while (reader.next(box)) {
+        xmin = std::min(xmin,box.lower[x]);
+        xmax = std::max(xmax,box.upper[x]);
+        ymin = std::min(ymin,box.lower[y]);
+        ymax = std::max(ymax,box.upper[y]);
+        if (!locations.count(box.location)) {
+          unsigned int index = locations.size();
+          locations[box.location] = index;
+        }
+        boxes++;
+      }
+    }
+    if (boxes == 0) {
+      std::cerr << "The stream is empty." << std::endl;
+      return 1;
+    }
+
+    // Second pass: the boxes, scaled on a fixed size image with y growing upwards.
+    const double width = 800.0, height = 800.0;
+    double xscale = width / std::max(xmax - xmin,1e-12);
+    double yscale = height / std::max(ymax - ymin,1e-12);
+
+    std::ofstream svg(argv[4]);
+    svg << "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"" << width << "\" height=\"" << height << "\">\n";
+    ReachStreamReader reader(argv[1]);
+    ReachBox box;
+    while (reader.next(box)) {
+      // Spreads the hues of the locations around the colour wheel.
+      unsigned int hue = (locations[box.location] * 360 / locations.size()) % 360;
+      svg << "<rect x=\"" << (box.lower[x] - xmin) * xscale
+          << "\" y=\"" << (ymax - box.upper[y]) * yscale
+          << "\" width=\"" << (box.upper[x] - box.lower[x]) * xscale
+          << "\" height=\"" << (box.upper[y] - box.lower[y]) * yscale
+          << "\" fill=\"hsl(" << hue << ",70%,50%)\" fill-opacity=\"0.4\" stroke=\"black\" stroke-width=\"0.2\"/>\n";
+    }
+    svg << "</svg>\n";
+
+    std::cout << boxes << " boxes in " << locations.size() << " locations, x in [" << xmin << "," << xmax
+              << "], y in [" << ymin << "," << ymax << "]." << std::endl;
+
+  } catch (std::exception& ex) {
+    std::cerr << ex.what() << std::endl;
+    return 1;
+  }
+}
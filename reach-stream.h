@@ -0,0 +1,188 @@
+/***************************************************************************
+*            reach-stream.h
+*
+*  This file is used to describe a compact binary format for reached sets,
+*  written box by box once each orbit or grid set of an analysis has been
+*  computed, since the evolver and the analyser return them whole, and
+*  read back offline, e.g. for rendering. It depends on the standard
+*  library only.
+*
+*  The file starts with the "WWRS" magic, the format version and the
+*  dimension of the boxes, all as 32 bit integers after the magic.
+*  Then each record starts with a tag byte:
+*  'L' defines a location: 32 bit identifier, 16 bit length, name;
+*  'E' (enclosure) and 'C' (grid cell) give a box in a location:
+*  32 bit location identifier, then lower and upper bound of each
+*  dimension as doubles.
+*
+*  Copyright  2018  Raffaello Corsini, Luca Geretti
+*
+****************************************************************************/
+
+/*
+*  This program is free software; you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation; either version 2 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Library General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program; if not, write to the Free Software
+*  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#ifndef REACH_STREAM_H
+#define REACH_STREAM_H
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace Ariadne {
+
+  // The kind of a box in a reach stream.
+  enum ReachBoxKind { REACH_ENCLOSURE = 'E', REACH_CELL = 'C' };
+
+  const uint32_t REACH_STREAM_VERSION = 1;
+
+  // A box read from a reach stream.
+  struct ReachBox {
+    ReachBoxKind kind;
+    std::string location;
+    std::vector<double> lower;
+    std::vector<double> upper;
+  };
+
+  /*
+  * Writes boxes to a reach stream as soon as they are given. Every location
+  * name is written once, the boxes refer to it by identifier. Writing is
+  * safe from several threads.
+  */
+  class ReachStreamWriter {
+
+      std::ofstream _file;
+      uint32_t _dimension;
+      std::map<std::string,uint32_t> _locations;
+      unsigned long _boxes;
+      std::mutex _lock;
+
+      template<class T> void _put(const T& value) {
+        _file.write(reinterpret_cast<const char*>(&value),sizeof(T));
+      }
+
+    public:
+
+      ReachStreamWriter(const std::string& filename, unsigned int dimension)
+        : _file(filename.c_str(), std::ios::binary | std::ios::trunc), _dimension(dimension), _boxes(0) {
+        if (!_file)
+          throw std::runtime_error("Cannot open reach stream '" + filename + "' for writing.");
+        _file.write("WWRS",4);
+        _put(REACH_STREAM_VERSION);
+        _put(_dimension);
+      }
+
+      unsigned int dimension() const { return _dimension; }
+
+      // The number of boxes written so far.
+      unsigned long size() const { return _boxes; }
+
+      void write(ReachBoxKind kind, const std::string& location, const std::vector<double>& lower, const std::vector<double>& upper) {
+        if (lower.size() != _dimension || upper.size() != _dimension)
+          throw std::invalid_argument("Box of the wrong dimension for the reach stream.");
+        std::lock_guard<std::mutex> guard(_lock);
+        std::map<std::string,uint32_t>::const_iterator it = _locations.find(location);
+        uint32_t id;
+        if (it == _locations.end()) {
+          id = _locations.size();
+          _locations[location] = id;
+          _put('L');
+          _put(id);
+          _put((uint16_t)location.size());
+          _file.write(location.data(),location.size());
+        } else {
+          id = it->second;
+        }
+        _put((char)kind);
+        _put(id);
+        for (uint32_t i = 0; i < _dimension; i++) {
+          _put(lower[i]);
+          _put(upper[i]);
+        }
+        _boxes++;
+      }
+
+      void flush() {
+        std::lock_guard<std::mutex> guard(_lock);
+        _file.flush();
+      }
+  };
+
+  // Reads back the boxes of a reach stream, one at a time.
+  class ReachStreamReader {
+
+      std::ifstream _file;
+      uint32_t _dimension;
+      std::map<uint32_t,std::string> _locations;
+
+      template<class T> bool _get(T& value) {
+        return (bool)_file.read(reinterpret_cast<char*>(&value),sizeof(T));
+      }
+
+    public:
+
+      ReachStreamReader(const std::string& filename) : _file(filename.c_str(), std::ios::binary) {
+        char magic[4];
+        uint32_t version;
+        if (!_file.read(magic,4) || std::memcmp(magic,"WWRS",4) != 0 || !_get(version) || !_get(_dimension))
+          throw std::runtime_error("'" + filename + "' is not a reach stream.");
+        if (version != REACH_STREAM_VERSION)
+          throw std::runtime_error("Unsupported version of the reach stream '" + filename + "'.");
+      }
+
+      unsigned int dimension() const { return _dimension; }
+
+      // Reads the next box, returning false at the end of the stream.
+      bool next(ReachBox& box) {
+        char tag;
+        while (_get(tag)) {
+          uint32_t id;
+          if (!_get(id))
+            break;
+          if (tag == 'L') {
+            uint16_t length;
+            if (!_get(length))
+              break;
+            std::string name(length,' ');
+            if (!_file.read(&name[0],length))
+              break;
+            _locations[id] = name;
+            continue;
+          }
+          if (tag != REACH_ENCLOSURE && tag != REACH_CELL)
+            throw std::runtime_error("Corrupted reach stream.");
+          box.kind = (ReachBoxKind)tag;
+          box.location = _locations[id];
+          box.lower.resize(_dimension);
+          box.upper.resize(_dimension);
+          for (uint32_t i = 0; i < _dimension; i++) {
+            if (!_get(box.lower[i]) || !_get(box.upper[i]))
+              throw std::runtime_error("Truncated reach stream.");
+          }
+          return true;
+        }
+        return false;
+      }
+  };
+
+}
+
+#endif
@@ -0,0 +1,121 @@
+/***************************************************************************
+*            simulate.cc
+*
+*  Runs the native simulator of the plant. It first simulates a single
+*  trajectory from the initial point of the analyses, printing the events
+*  taken, then a Monte Carlo batch where the input flows of the side tanks
+*  are sampled, reporting the extreme water levels and the throughput.
+*  It does not need the library, so it can run on any machine.
+*
+*  Usage: waterworld_sim [tanks] [samples] [horizon] [min input flow] [max input flow]
+*  The arguments are checked, and -h or --help prints their meaning.
+*
+*  Copyright  2018  Raffaello Corsini, Luca Geretti
+*
+****************************************************************************/
+
+/*
+*  This program is free software; you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation; either version 2 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Library General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program; if not, write to the Free Software
+*  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include "arguments.h"
+#include "simulator.h"
+
+using namespace Ariadne;
+
+// Prints the usage, with the error which led to it if any, returning the exit status
+int usage(const char* program, const std::string& error) {
+  std::ostream& out = (error.empty() ? std::cout : std::cerr);
+  if (!error.empty())
+    out << program << ": " << error << std::endl;
+  out << "Usage: " << program << " [tanks] [samples] [horizon] [min input flow] [max input flow]" << std::endl
+      << "  tanks           the tanks of the binary tree, at least 2 (default 3)" << std::endl
+      << "  samples         the trajectories of the Monte Carlo batch, at least 1 (default 10000)" << std::endl
+      << "  horizon         the time simulated, positive (default 8)" << std::endl
+      << "  input flows     the range of the input flows of the side tanks, not negative (default 0.4 0.6)" << std::endl;
+  return (error.empty() ? 0 : 1);
+}
+
+int main(int argc,char *argv[])
+{
+  if (help_requested(argc,argv))
+    return usage(argv[0],"");
+  if (argc > 6)
+    return usage(argv[0],"too many arguments.");
+
+  // The plant is a binary tree of tanks, by default the original one with three tanks
+  long tanks_argument = 3;
+  if (argc > 1 && !parse_integer(argv[1],2,100000,tanks_argument))
+    return usage(argv[0],"the tanks must be a whole number of at least 2, not '" + std::string(argv[1]) + "'.");
+  unsigned int tanks = tanks_argument;
+
+  long samples_argument = 10000;
+  if (argc > 2 && !parse_integer(argv[2],1,1000000000,samples_argument))
+    return usage(argv[0],"the samples must be a whole positive number, not '" + std::string(argv[2]) + "'.");
+  unsigned int samples = samples_argument;
+
+  SimulationSettings settings;
+  if (argc > 3 && (!parse_real(argv[3],0,1e300,settings.horizon) || settings.horizon <= 0))
+    return usage(argv[0],"the horizon must be a positive number, not '" + std::string(argv[3]) + "'.");
+
+  // The range of the input flows of the side tanks, around the nominal 0.5
+  double minimum_input_flow = 0.4, maximum_input_flow = 0.6;
+  if (argc == 5)
+    return usage(argv[0],"the input flows need both a minimum and a maximum.");
+  if (argc > 5 && (!parse_real(argv[4],0,1e300,minimum_input_flow) || !parse_real(argv[5],minimum_input_flow,1e300,maximum_input_flow)))
+    return usage(argv[0],"the input flows must be a range of numbers not negative, not '" + std::string(argv[4]) + "' to '" + std::string(argv[5]) + "'.");
+
+  try {
+    PlantSimulator simulator(getBinaryTreeTopology(tanks));
+    PlantState initial = simulator.initial_state();
+    std::cout << "Vector field: " << (simulator.is_specialised() ? "compiled for the structure of the plant" : "generic") << "." << std::endl;
+
+    // A single trajectory from the initial point
+    SimulationResult single = simulator.simulate(initial,settings);
+    std::cout << "Single trajectory: " << single.steps << " steps (" << single.rejected_steps << " rejected, "
+              << single.closed_form_steps << " in closed form), "
+              << single.events.size() << " events." << std::endl;
+    for (unsigned int i = 0; i < single.events.size(); i++)
+      std::cout << "  t=" << single.events[i].time << " " << single.events[i].name << std::endl;
+    for (unsigned int k = 0; k < tanks; k++)
+      std::cout << "  waterLevel" << k << " in [" << single.minimum_waterlevels[k] << "," << single.maximum_waterlevels[k]
+                << "], final " << single.final.levels[k] << std::endl;
+
+    // The Monte Carlo batch
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::vector<SimulationResult> results = simulate_batch(simulator,initial,settings,samples,
+        minimum_input_flow,maximum_input_flow,0,std::thread::hardware_concurrency());
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::vector<double> minimum(tanks,1e300), maximum(tanks,-1e300);
+    for (unsigned int i = 0; i < results.size(); i++) {
+      for (unsigned int k = 0; k < tanks; k++) {
+        minimum[k] = std::min(minimum[k],results[i].minimum_waterlevels[k]);
+        maximum[k] = std::max(maximum[k],results[i].maximum_waterlevels[k]);
+      }
+    }
+    std::cout << "Batch of " << samples << " trajectories with input flows in [" << minimum_input_flow << "," << maximum_input_flow
+              << "]: " << elapsed << " s, " << samples / elapsed << " trajectories per second." << std::endl;
+    for (unsigned int k = 0; k < tanks; k++)
+      std::cout << "  waterLevel" << k << " in [" << minimum[k] << "," << maximum[k] << "]" << std::endl;
+
+  } catch (std::exception& ex) {
+    std::cerr << ex.what() << std::endl;
+    return 1;
+  }
+}
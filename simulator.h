@@ -0,0 +1,601 @@
+/***************************************************************************
+*            simulator.h
+*
+*  This file is used to describe a native simulator of the plant, working
+*  on floating point points instead of enclosures. The dynamics, the guards
+*  and the resets are those of getSideTank, getMiddleTank, getBottomTank,
+*  getValve and getUrgentController, for the plant given by a topology.
+*  With the controllers of getController, which switch anywhere within
+*  delta of a threshold, it simulates the run switching at the threshold.
+*  The flow is integrated with an adaptive Dormand-Prince 5(4) method, and
+*  the crossing of each guard is located by a root finder on the step.
+*  Where all the valves are idle the valve levels are constant, hence the
+*  vector field is affine in the water levels: there the flow is computed
+*  in closed form, with a matrix exponential, instead of being integrated,
+*  and the guard crossings are located on the closed form flow as well.
+*  A guard is checked at both ends of each step and, where its rate goes
+*  from positive to negative within the step, at its maximum as well, so
+*  that a level which goes over a threshold and back within a step is not
+*  missed as long as it has one extremum in the step.
+*  It is meant for quick what-if checks and Monte Carlo sampling of the
+*  input flows; it gives no guarantee, unlike the analyses.
+*  It depends on the standard library only.
+*
+*  Copyright  2018  Raffaello Corsini, Luca Geretti
+*
+****************************************************************************/
+
+/*
+*  This program is free software; you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation; either version 2 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Library General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program; if not, write to the Free Software
+*  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#ifndef SIMULATOR_H
+#define SIMULATOR_H
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "topology.h"
+#include "component-models.h"
+
+namespace Ariadne {
+
+  /*
+  * The state of the plant: the continuous part holds the water levels of
+  * all the tanks followed by the valve levels of all the valves.
+  */
+  struct PlantState {
+    double time;
+    std::vector<double> levels;
+    std::vector<ValveMode> valves;
+    std::vector<ControllerMode> controllers;
+  };
+
+  // An event taken during a simulation, e.g. "e_close_0".
+  struct SimulationEvent {
+    double time;
+    std::string name;
+  };
+
+  struct SimulationSettings {
+    // The simulation stops at this time, or after this number of events.
+    double horizon;
+    unsigned int maximum_events;
+    // Tolerances of the integration error.
+    double absolute_tolerance;
+    double relative_tolerance;
+    // The largest step allowed.
+    double maximum_step_size;
+    // The width of the time interval where a guard crossing is located.
+    double event_tolerance;
+    // Whether to keep the state after each step.
+    bool record_trajectory;
+    // Whether to use the closed form flow where the vector field is affine, and the size of its steps,
+    // which have no error to control; they are not larger than the maximum step size either. As for the
+    // other steps, a guard which holds only within a step is found at the maximum of the guard, hence
+    // the steps may be long, though not so long that a level has two extrema in a step. The exponential
+    // is a dense matrix of the size of the plant, hence for large plants the integration may be cheaper.
+    bool closed_form;
+    double closed_form_step_size;
+
+    SimulationSettings() : horizon(8.0), maximum_events(1000), absolute_tolerance(1e-9), relative_tolerance(1e-9),
+      maximum_step_size(1.0), event_tolerance(1e-12), record_trajectory(false), closed_form(true), closed_form_step_size(2.0) { }
+  };
+
+  struct SimulationResult {
+    PlantState final;
+    // The extreme water levels of each tank, at the steps and the events.
+    std::vector<double> minimum_waterlevels;
+    std::vector<double> maximum_waterlevels;
+    std::vector<SimulationEvent> events;
+    std::vector<PlantState> trajectory;
+    unsigned int steps;
+    unsigned int rejected_steps;
+    // The steps taken with the closed form flow, among all the steps.
+    unsigned int closed_form_steps;
+  };
+
+  class PlantSimulator {
+
+      // An active guard: the transition is taken as soon as its value is not negative.
+      enum GuardKind { CONTROLLER_GUARD, VALVE_GUARD };
+      struct Guard {
+        GuardKind kind;
+        unsigned int component;
+      };
+
+      PlantTopology _topology;
+      unsigned int _n;
+      std::vector< std::vector<unsigned int> > _upstream;
+      // The vector field compiled for the structure of the plant, if any.
+      SpecialisedDerivative _specialised;
+
+    public:
+
+      PlantSimulator(const PlantTopology& topology) : _topology(topology), _n(topology.size()), _specialised(0) {
+        _topology.check();
+        for (unsigned int k = 0; k < _n; k++)
+          _upstream.push_back(_topology.upstream(k));
+        _specialised = getSpecialisedDerivative(_topology);
+      }
+
+      // Whether the vector field is the one compiled for the structure of the plant.
+      bool is_specialised() const { return _specialised != 0; }
+
+      const PlantTopology& topology() const { return _topology; }
+
+      // The initial state of the analyses: all valves idle and open, all controllers rising.
+      PlantState initial_state(double valvelevel = 1.0, double waterlevel = 7.0) const {
+        PlantState state;
+        state.time = 0.0;
+        state.levels.assign(2*_n,waterlevel);
+        std::fill(state.levels.begin() + _n,state.levels.end(),valvelevel);
+        state.valves.assign(_n,VALVE_IDLE);
+        state.controllers.assign(_n,CONTROLLER_RISING);
+        return state;
+      }
+
+      // The vector field of the plant in the given modes.
+      void derivative(const PlantState& modes, const double* y, double* dy) const {
+        if (_specialised) {
+          _specialised(_topology,modes.valves.data(),y,dy);
+          return;
+        }
+        for (unsigned int k = 0; k < _n; k++) {
+          const TankDescription& tank = _topology.tanks[k];
+          double inflow = 0.0;
+          if (_upstream[k].empty()) {
+            inflow = TankModel::source_inflow(tank.input_flow,y[_n + k]);
+          } else {
+            for (unsigned int i = 0; i < _upstream[k].size(); i++) {
+              unsigned int u = _upstream[k][i];
+              inflow += TankModel::upper_inflow(_topology.tanks[u].output_flow,y[_n + k],y[u]);
+            }
+          }
+          double outflow = (tank.downstream < 0 ? TankModel::bottom_outflow(tank.output_flow,y[k])
+                                                : TankModel::lower_outflow(tank.output_flow,y[_n + tank.downstream],y[k]));
+          dy[k] = inflow - outflow;
+          dy[_n + k] = ValveModel::rate(modes.valves[k],_topology.opening_time);
+        }
+      }
+
+      // Simulates from the given state.
+      SimulationResult simulate(const PlantState& initial, const SimulationSettings& settings) const {
+
+        SimulationResult result;
+        result.steps = 0;
+        result.rejected_steps = 0;
+        result.closed_form_steps = 0;
+        PlantState state = initial;
+        result.minimum_waterlevels.assign(state.levels.begin(),state.levels.begin() + _n);
+        result.maximum_waterlevels = result.minimum_waterlevels;
+        if (settings.record_trajectory)
+          result.trajectory.push_back(state);
+
+        std::vector<double> next(2*_n), error(2*_n);
+        double h = std::min(settings.maximum_step_size,0.1);
+
+        // The exponential of the last full closed form step, which is reused as long as the valve levels
+        // are the same, since the steps in between the events all have the same size
+        std::vector<double> exponential, exponential_valvelevels;
+        double exponential_step = 0.0;
+
+        _take_urgent_transitions(state,result);
+
+        while (state.time < settings.horizon && result.events.size() < settings.maximum_events) {
+
+          bool affine = settings.closed_form && _is_affine(state);
+          double factor = 1.0;
+          if (affine) {
+            h = std::min(std::min(settings.closed_form_step_size,settings.maximum_step_size),settings.horizon - state.time);
+            std::vector<double> valvelevels(state.levels.begin() + _n,state.levels.end());
+            if (h != exponential_step || valvelevels != exponential_valvelevels) {
+              exponential = _affine_exponential(state.levels.data(),h);
+              exponential_step = h;
+              exponential_valvelevels = valvelevels;
+            }
+            _apply_affine(exponential,state.levels.data(),next.data());
+          } else {
+            h = std::min(h,settings.horizon - state.time);
+            _step(state,state.levels.data(),h,next.data(),error.data());
+
+            // Error control on the step
+            double norm = 0.0;
+            for (unsigned int i = 0; i < 2*_n; i++) {
+              double scale = settings.absolute_tolerance + settings.relative_tolerance * std::max(std::fabs(state.levels[i]),std::fabs(next[i]));
+              norm = std::max(norm,std::fabs(error[i]) / scale);
+            }
+            factor = (norm == 0.0 ? 5.0 : std::min(5.0,std::max(0.2,0.9 * std::pow(norm,-0.2))));
+            if (norm > 1.0) {
+              result.rejected_steps++;
+              h *= factor;
+              continue;
+            }
+          }
+
+          // Location of the earliest guard crossing within the step, on the same flow as the step: the closed
+          // form one, whose matrix is built only when a guard is crossed, or the integration step
+          std::vector<Guard> guards = _active_guards(state);
+          std::vector<double> matrix;
+          std::function<void(double,double*)> flow = [&](double t, double* y) {
+            if (affine) {
+              if (matrix.empty())
+                matrix = _affine_matrix(state.levels.data());
+              _affine_flow(matrix,state.levels.data(),t,y);
+            } else {
+              std::vector<double> unused(2*_n);
+              _step(state,state.levels.data(),t,y,unused.data());
+            }
+          };
+          // A guard which does not hold at the end of the step may still hold within it, where it stops rising
+          std::vector<double> start_rates(2*_n), end_rates(2*_n), peak_levels(2*_n);
+          derivative(state,state.levels.data(),start_rates.data());
+          derivative(state,next.data(),end_rates.data());
+          double crossing = h;
+          for (unsigned int i = 0; i < guards.size(); i++) {
+            if (_guard(state,guards[i],next.data()) >= 0.0) {
+              crossing = std::min(crossing,_locate(state,guards[i],h,settings.event_tolerance,flow));
+            } else if (_guard_rate(state,guards[i],state.levels.data(),start_rates.data()) > 0.0
+                       && _guard_rate(state,guards[i],next.data(),end_rates.data()) < 0.0) {
+              double peak = _locate_peak(state,guards[i],h,settings.event_tolerance,flow);
+              flow(peak,peak_levels.data());
+              if (peak < crossing && _guard(state,guards[i],peak_levels.data()) >= 0.0)
+                crossing = std::min(crossing,_locate(state,guards[i],peak,settings.event_tolerance,flow));
+            }
+          }
+          if (crossing < h)
+            flow(crossing,next.data());
+
+          state.time += crossing;
+          state.levels = next;
+          result.steps++;
+          if (affine)
+            result.closed_form_steps++;
+          _update_extremes(state,result);
+          _take_urgent_transitions(state,result);
+          if (settings.record_trajectory)
+            result.trajectory.push_back(state);
+
+          h = std::min(settings.maximum_step_size,h * factor);
+        }
+
+        result.final = state;
+        return result;
+      }
+
+    private:
+
+      // The guards of the transitions which may be taken in the current modes. A controller
+      // can send its event only while its valve is idle, since only then the valve receives it.
+      std::vector<Guard> _active_guards(const PlantState& state) const {
+        std::vector<Guard> guards;
+        for (unsigned int k = 0; k < _n; k++) {
+          Guard guard;
+          guard.component = k;
+          guard.kind = (state.valves[k] == VALVE_IDLE ? CONTROLLER_GUARD : VALVE_GUARD);
+          guards.push_back(guard);
+        }
+        return guards;
+      }
+
+      // The value of a guard in the given modes, as in getUrgentController and getValve.
+      double _guard(const PlantState& modes, const Guard& guard, const double* y) const {
+        unsigned int k = guard.component;
+        if (guard.kind == CONTROLLER_GUARD)
+          return ControllerModel::guard(modes.controllers[k],y[k],_topology.hmin,_topology.hmax);
+        return ValveModel::guard(modes.valves[k],y[_n + k]);
+      }
+
+      // The rate of change of a guard at the given levels, along the given derivative: the guards are affine
+      // in the levels, hence it is the difference of the guard after a unit time step along the derivative.
+      double _guard_rate(const PlantState& modes, const Guard& guard, const double* y, const double* dy) const {
+        std::vector<double> z(2*_n);
+        for (unsigned int i = 0; i < 2*_n; i++)
+          z[i] = y[i] + dy[i];
+        return _guard(modes,guard,z.data()) - _guard(modes,guard,y);
+      }
+
+      // Whether the vector field is affine in the current modes, i.e. all the valves are idle.
+      bool _is_affine(const PlantState& modes) const {
+        for (unsigned int k = 0; k < _n; k++) {
+          if (modes.valves[k] != VALVE_IDLE)
+            return false;
+        }
+        return true;
+      }
+
+      /*
+      * The augmented matrix M = [A b; 0 0] of the affine vector field y' = A y + b of the water levels,
+      * for the valve levels of the given state and all the valves idle, so that the water levels after
+      * a time h are the product of the first rows of the exponential of h M with (y,1).
+      * A and b are read from the vector field itself, at the origin and at the unit water levels.
+      */
+      std::vector<double> _affine_matrix(const double* y) const {
+        unsigned int m = _n + 1;
+        PlantState modes;
+        modes.valves.assign(_n,VALVE_IDLE);
+        std::vector<double> z(y,y + 2*_n), origin(2*_n), dy(2*_n);
+        std::fill(z.begin(),z.begin() + _n,0.0);
+        derivative(modes,z.data(),origin.data());
+        std::vector<double> matrix(m*m,0.0);
+        for (unsigned int i = 0; i < _n; i++)
+          matrix[i*m + _n] = origin[i];
+        for (unsigned int j = 0; j < _n; j++) {
+          z[j] = 1.0;
+          derivative(modes,z.data(),dy.data());
+          for (unsigned int i = 0; i < _n; i++)
+            matrix[i*m + j] = dy[i] - origin[i];
+          z[j] = 0.0;
+        }
+        return matrix;
+      }
+
+      // The norm of a matrix of the given size, as the largest sum of the absolute values of a row.
+      static double _norm(const std::vector<double>& matrix, unsigned int m) {
+        double norm = 0.0;
+        for (unsigned int i = 0; i < m; i++) {
+          double row = 0.0;
+          for (unsigned int j = 0; j < m; j++)
+            row += std::fabs(matrix[i*m + j]);
+          norm = std::max(norm,row);
+        }
+        return norm;
+      }
+
+      /*
+      * The exponential of h M, for the augmented matrix M of _affine_matrix.
+      * The exponential is the Taylor series of the matrix scaled to a norm of at most 1/4, then squared back.
+      */
+      std::vector<double> _affine_exponential(const double* y, double h) const {
+        unsigned int m = _n + 1;
+        std::vector<double> matrix = _affine_matrix(y);
+        for (unsigned int i = 0; i < m*m; i++)
+          matrix[i] *= h;
+
+        double norm = _norm(matrix,m);
+        unsigned int squarings = 0;
+        for (; norm > 0.25; norm /= 2)
+          squarings++;
+        for (unsigned int i = 0; i < m*m; i++)
+          matrix[i] = std::ldexp(matrix[i],-(int)squarings);
+
+        std::vector<double> result(m*m,0.0), term(m*m,0.0);
+        for (unsigned int i = 0; i < m; i++)
+          result[i*m + i] = term[i*m + i] = 1.0;
+        for (unsigned int degree = 1; degree <= 16; degree++) {
+          term = _product(term,matrix,m);
+          for (unsigned int i = 0; i < m*m; i++) {
+            term[i] /= degree;
+            result[i] += term[i];
+          }
+        }
+        for (unsigned int i = 0; i < squarings; i++)
+          result = _product(result,result,m);
+        return result;
+      }
+
+      static std::vector<double> _product(const std::vector<double>& a, const std::vector<double>& b, unsigned int m) {
+        std::vector<double> c(m*m,0.0);
+        for (unsigned int i = 0; i < m; i++)
+          for (unsigned int l = 0; l < m; l++)
+            for (unsigned int j = 0; j < m; j++)
+              c[i*m + j] += a[i*m + l] * b[l*m + j];
+        return c;
+      }
+
+      // The state after the closed form flow of the given exponential; the valve levels do not change.
+      void _apply_affine(const std::vector<double>& exponential, const double* y, double* next) const {
+        unsigned int m = _n + 1;
+        for (unsigned int i = 0; i < _n; i++) {
+          double value = exponential[i*m + _n];
+          for (unsigned int j = 0; j < _n; j++)
+            value += exponential[i*m + j] * y[j];
+          next[i] = value;
+        }
+        for (unsigned int k = 0; k < _n; k++)
+          next[_n + k] = y[_n + k];
+      }
+
+      /*
+      * The state after a time t of the closed form flow of the augmented matrix M of _affine_matrix, from y:
+      * the Taylor series of the exponential of t M is applied to (y,1) directly, over as many equal substeps
+      * as needed for t M to have a norm of at most 1/4 in each. It takes products of the matrix with vectors
+      * only, hence it is much cheaper than an exponential when the flow is wanted at a single time.
+      */
+      void _affine_flow(const std::vector<double>& matrix, const double* y, double t, double* next) const {
+        unsigned int m = _n + 1;
+        unsigned int substeps = 1;
+        for (double norm = t * _norm(matrix,m); norm > 0.25; norm /= 2)
+          substeps *= 2;
+        double tau = t / substeps;
+        std::vector<double> z(m), term(m), product(m);
+        std::copy(y,y + _n,z.begin());
+        z[_n] = 1.0;
+        for (unsigned int s = 0; s < substeps; s++) {
+          term = z;
+          for (unsigned int degree = 1; degree <= 16; degree++) {
+            for (unsigned int i = 0; i < m; i++) {
+              double value = 0.0;
+              for (unsigned int j = 0; j < m; j++)
+                value += matrix[i*m + j] * term[j];
+              product[i] = tau * value / degree;
+            }
+            term.swap(product);
+            for (unsigned int i = 0; i < m; i++)
+              z[i] += term[i];
+          }
+        }
+        for (unsigned int i = 0; i < _n; i++)
+          next[i] = z[i];
+        for (unsigned int k = 0; k < _n; k++)
+          next[_n + k] = y[_n + k];
+      }
+
+      // Finds the time, within the step, where the guard becomes non-negative, on the given flow from the state.
+      // The returned time is the upper end of the final bracket, so that the guard holds there.
+      double _locate(const PlantState& state, const Guard& guard, double h, double tolerance, const std::function<void(double,double*)>& flow) const {
+        std::vector<double> y(2*_n);
+        double lower = 0.0, upper = h;
+        double glower = _guard(state,guard,state.levels.data());
+        flow(upper,y.data());
+        double gupper = _guard(state,guard,y.data());
+        // Illinois variant of the regula falsi
+        int side = 0;
+        while (upper - lower > tolerance) {
+          double middle = (glower * upper - gupper * lower) / (glower - gupper);
+          if (!(middle > lower && middle < upper))
+            middle = 0.5 * (lower + upper);
+          flow(middle,y.data());
+          double gmiddle = _guard(state,guard,y.data());
+          if (gmiddle >= 0.0) {
+            upper = middle;
+            gupper = gmiddle;
+            if (side == -1)
+              glower /= 2;
+            side = -1;
+          } else {
+            lower = middle;
+            glower = gmiddle;
+            if (side == 1)
+              gupper /= 2;
+            side = 1;
+          }
+        }
+        return upper;
+      }
+
+      // Finds the time, within the step, where the rate of the guard goes from positive to negative, on the given
+      // flow from the state, by bisection.
+      double _locate_peak(const PlantState& state, const Guard& guard, double h, double tolerance, const std::function<void(double,double*)>& flow) const {
+        std::vector<double> y(2*_n), dy(2*_n);
+        double lower = 0.0, upper = h;
+        while (upper - lower > tolerance) {
+          double middle = 0.5 * (lower + upper);
+          flow(middle,y.data());
+          derivative(state,y.data(),dy.data());
+          if (_guard_rate(state,guard,y.data(),dy.data()) > 0.0)
+            lower = middle;
+          else
+            upper = middle;
+        }
+        return lower;
+      }
+
+      // Takes all the transitions whose guards hold, as they are urgent.
+      void _take_urgent_transitions(PlantState& state, SimulationResult& result) const {
+        // Each component can take at most one transition for each of its two modes in a row
+        for (unsigned int round = 0; round <= 4*_n; round++) {
+          std::vector<Guard> guards = _active_guards(state);
+          bool taken = false;
+          for (unsigned int i = 0; i < guards.size(); i++) {
+            if (_guard(state,guards[i],state.levels.data()) < 0.0)
+              continue;
+            unsigned int k = guards[i].component;
+            std::string number = std::to_string(k);
+            SimulationEvent event;
+            event.time = state.time;
+            if (guards[i].kind == CONTROLLER_GUARD) {
+              bool rising = (state.controllers[k] == CONTROLLER_RISING);
+              state.controllers[k] = (rising ? CONTROLLER_FALLING : CONTROLLER_RISING);
+              state.valves[k] = (rising ? VALVE_CLOSING : VALVE_OPENING);
+              event.name = (rising ? "e_close_" : "e_open_") + number;
+            } else {
+              state.levels[_n + k] = (state.valves[k] == VALVE_OPENING ? 1.0 : 0.0);
+              state.valves[k] = VALVE_IDLE;
+              event.name = "e_idle_" + number;
+            }
+            result.events.push_back(event);
+            taken = true;
+          }
+          if (!taken)
+            return;
+        }
+      }
+
+      void _update_extremes(const PlantState& state, SimulationResult& result) const {
+        for (unsigned int k = 0; k < _n; k++) {
+          result.minimum_waterlevels[k] = std::min(result.minimum_waterlevels[k],state.levels[k]);
+          result.maximum_waterlevels[k] = std::max(result.maximum_waterlevels[k],state.levels[k]);
+        }
+      }
+
+      // A Dormand-Prince step: the fifth order solution and its difference from the fourth order one.
+      void _step(const PlantState& modes, const double* y, double h, double* y5, double* error) const {
+        static const double a21 = 1.0/5;
+        static const double a31 = 3.0/40, a32 = 9.0/40;
+        static const double a41 = 44.0/45, a42 = -56.0/15, a43 = 32.0/9;
+        static const double a51 = 19372.0/6561, a52 = -25360.0/2187, a53 = 64448.0/6561, a54 = -212.0/729;
+        static const double a61 = 9017.0/3168, a62 = -355.0/33, a63 = 46732.0/5247, a64 = 49.0/176, a65 = -5103.0/18656;
+        static const double b1 = 35.0/384, b3 = 500.0/1113, b4 = 125.0/192, b5 = -2187.0/6784, b6 = 11.0/84;
+        static const double e1 = 35.0/384 - 5179.0/57600, e3 = 500.0/1113 - 7571.0/16695, e4 = 125.0/192 - 393.0/640,
+                            e5 = -2187.0/6784 + 92097.0/339200, e6 = 11.0/84 - 187.0/2100, e7 = -1.0/40;
+        unsigned int d = 2*_n;
+        std::vector<double> k1(d), k2(d), k3(d), k4(d), k5(d), k6(d), k7(d), t(d);
+        derivative(modes,y,k1.data());
+        for (unsigned int i = 0; i < d; i++) t[i] = y[i] + h*a21*k1[i];
+        derivative(modes,t.data(),k2.data());
+        for (unsigned int i = 0; i < d; i++) t[i] = y[i] + h*(a31*k1[i] + a32*k2[i]);
+        derivative(modes,t.data(),k3.data());
+        for (unsigned int i = 0; i < d; i++) t[i] = y[i] + h*(a41*k1[i] + a42*k2[i] + a43*k3[i]);
+        derivative(modes,t.data(),k4.data());
+        for (unsigned int i = 0; i < d; i++) t[i] = y[i] + h*(a51*k1[i] + a52*k2[i] + a53*k3[i] + a54*k4[i]);
+        derivative(modes,t.data(),k5.data());
+        for (unsigned int i = 0; i < d; i++) t[i] = y[i] + h*(a61*k1[i] + a62*k2[i] + a63*k3[i] + a64*k4[i] + a65*k5[i]);
+        derivative(modes,t.data(),k6.data());
+        for (unsigned int i = 0; i < d; i++) y5[i] = y[i] + h*(b1*k1[i] + b3*k3[i] + b4*k4[i] + b5*k5[i] + b6*k6[i]);
+        derivative(modes,y5,k7.data());
+        for (unsigned int i = 0; i < d; i++) error[i] = h*(e1*k1[i] + e3*k3[i] + e4*k4[i] + e5*k5[i] + e6*k6[i] + e7*k7[i]);
+      }
+  };
+
+  /*
+  * Simulates the plant from the given state for a number of samples, each one with the input
+  * flows of the side tanks drawn uniformly and independently from the given range.
+  * The samples are spread over the given number of threads; the same seed gives the same samples.
+  */
+  std::vector<SimulationResult> simulate_batch(const PlantSimulator& simulator, const PlantState& initial, const SimulationSettings& settings,
+      unsigned int samples, double minimum_input_flow, double maximum_input_flow, unsigned long seed, unsigned int threads) {
+
+    std::vector<SimulationResult> results(samples);
+    threads = std::max(1u,std::min(threads,samples));
+
+    std::vector<std::thread> workers;
+    for (unsigned int w = 0; w < threads; w++) {
+      workers.push_back(std::thread([&,w]() {
+        for (unsigned int i = w; i < samples; i += threads) {
+          std::mt19937_64 generator(seed + i);
+          std::uniform_real_distribution<double> input_flow(minimum_input_flow,maximum_input_flow);
+          PlantTopology topology = simulator.topology();
+          for (unsigned int k = 0; k < topology.size(); k++) {
+            if (topology.is_source(k))
+              topology.tanks[k].input_flow = input_flow(generator);
+          }
+          results[i] = PlantSimulator(topology).simulate(initial,settings);
+        }
+      }));
+    }
+    for (unsigned int w = 0; w < workers.size(); w++)
+      workers[w].join();
+
+    return results;
+  }
+
+}
+
+#endif
@@ -0,0 +1,186 @@
+/***************************************************************************
+*            symmetry.h
+*
+*  This file is used to describe the symmetries of a plant. Two branches
+*  flowing into the same tank are interchangeable when they have the same
+*  shape and the same parameters: swapping them, along with their valves
+*  and controllers, gives the same system. A state of the plant is then
+*  equivalent to all the states obtained by such swaps, and only one
+*  representative of each class, the canonical one, needs to be analysed
+*  when the property checked is symmetric too. Every permutation given
+*  is checked to map the plant onto itself, hence a plant without equal
+*  branches, e.g. a cascade, is never reduced.
+*  It depends on the standard library only.
+*
+*  Copyright  2018  Raffaello Corsini, Luca Geretti
+*
+****************************************************************************/
+
+/*
+*  This program is free software; you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation; either version 2 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Library General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program; if not, write to the Free Software
+*  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#ifndef SYMMETRY_H
+#define SYMMETRY_H
+
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "topology.h"
+
+namespace Ariadne {
+
+  class PlantSymmetry {
+
+      PlantTopology _topology;
+      unsigned int _root;
+      std::vector< std::vector<unsigned int> > _children;
+      // The shape of the branch ending in each tank, along with its parameters:
+      // two branches can be swapped if they have the same shape.
+      std::vector<std::string> _shapes;
+      // The tanks in the order of the traversal of the reference representative.
+      std::vector<unsigned int> _reference;
+      // The number of equivalent states of each state with distinct branches.
+      double _order;
+
+    public:
+
+      PlantSymmetry(const PlantTopology& topology) : _topology(topology), _root(0), _order(1.0) {
+        _topology.check();
+        unsigned int n = _topology.size();
+        _children.resize(n);
+        _shapes.resize(n);
+        for (unsigned int k = 0; k < n; k++) {
+          if (_topology.is_bottom(k))
+            _root = k;
+          _children[k] = _topology.upstream(k);
+        }
+        _shape(_root);
+        _traverse(_root,std::vector<std::string>(n),_reference);
+      }
+
+      // Whether some branches can be swapped.
+      bool is_symmetric() const { return _order > 1.0; }
+
+      // The number of states equivalent to a state whose swappable branches are all different.
+      double order() const { return _order; }
+
+      // The shape of the branch ending in the given tank.
+      const std::string& shape(unsigned int k) const { return _shapes[k]; }
+
+      /*
+      * Given a signature for the state of each tank (with its valve and controller),
+      * returns the permutation giving the canonical representative of the state:
+      * the tank k of the representative takes the state of the tank permutation[k].
+      * Two states are equivalent iff the permuted signatures are the same.
+      */
+      std::vector<unsigned int> canonical_permutation(const std::vector<std::string>& signatures) const {
+        std::vector<unsigned int> traversal;
+        _traverse(_root,signatures,traversal);
+        std::vector<unsigned int> permutation(traversal.size());
+        for (unsigned int i = 0; i < traversal.size(); i++)
+          permutation[_reference[i]] = traversal[i];
+        if (!is_automorphism(permutation))
+          throw std::logic_error("The canonical permutation does not map the plant onto itself.");
+        return permutation;
+      }
+
+      /*
+      * Whether the permutation, as given by canonical_permutation, maps the plant onto itself:
+      * each tank of the representative flows into the tank which takes the state of the one its
+      * source flows into, and has the same parameters, hence the permuted states evolve as the
+      * images of the states.
+      */
+      bool is_automorphism(const std::vector<unsigned int>& permutation) const {
+        unsigned int n = _topology.size();
+        if (permutation.size() != n)
+          return false;
+        std::vector<bool> taken(n,false);
+        for (unsigned int k = 0; k < n; k++) {
+          if (permutation[k] >= n || taken[permutation[k]])
+            return false;
+          taken[permutation[k]] = true;
+        }
+        for (unsigned int k = 0; k < n; k++) {
+          const TankDescription& tank = _topology.tanks[k];
+          const TankDescription& source = _topology.tanks[permutation[k]];
+          if ((tank.downstream < 0) != (source.downstream < 0) || tank.output_flow != source.output_flow)
+            return false;
+          if (tank.downstream >= 0 && permutation[tank.downstream] != (unsigned int)source.downstream)
+            return false;
+          if (_children[k].empty() && (!_children[permutation[k]].empty() || tank.input_flow != source.input_flow))
+            return false;
+        }
+        return true;
+      }
+
+    private:
+
+      // Computes the shapes of the branch ending in a tank and of all its sub-branches,
+      // counting the swaps allowed by the branches of equal shape.
+      const std::string& _shape(unsigned int k) {
+        std::vector<std::string> children;
+        for (unsigned int i = 0; i < _children[k].size(); i++)
+          children.push_back(_shape(_children[k][i]));
+        std::sort(children.begin(),children.end());
+        for (unsigned int i = 0, equal = 1; i < children.size(); i++, equal++) {
+          if (i + 1 == children.size() || children[i] != children[i+1]) {
+            for (unsigned int f = 2; f <= equal; f++)
+              _order *= f;
+            equal = 0;
+          }
+        }
+        std::ostringstream shape;
+        shape.precision(17);
+        shape << "(" << _topology.tanks[k].output_flow;
+        if (children.empty())
+          shape << "," << _topology.tanks[k].input_flow;
+        for (unsigned int i = 0; i < children.size(); i++)
+          shape << children[i];
+        shape << ")";
+        _shapes[k] = shape.str();
+        return _shapes[k];
+      }
+
+      // The signature of the state of a whole branch, in its canonical order.
+      std::string _branch_signature(unsigned int k, const std::vector<std::string>& signatures) const {
+        std::vector<unsigned int> traversal;
+        _traverse(k,signatures,traversal);
+        std::string signature;
+        for (unsigned int i = 0; i < traversal.size(); i++)
+          signature += signatures[traversal[i]] + ";";
+        return signature;
+      }
+
+      // Appends the tanks of a branch, the last tank first, then the upper branches ordered
+      // by shape, and the branches of equal shape by the signature of their state.
+      void _traverse(unsigned int k, const std::vector<std::string>& signatures, std::vector<unsigned int>& traversal) const {
+        traversal.push_back(k);
+        std::vector< std::pair< std::pair<std::string,std::string>, unsigned int > > children;
+        for (unsigned int i = 0; i < _children[k].size(); i++) {
+          unsigned int child = _children[k][i];
+          children.push_back(std::make_pair(std::make_pair(_shapes[child],_branch_signature(child,signatures)),child));
+        }
+        std::sort(children.begin(),children.end());
+        for (unsigned int i = 0; i < children.size(); i++)
+          _traverse(children[i].second,signatures,traversal);
+      }
+  };
+
+}
+
+#endif
@@ -4,6 +4,7 @@
 *  This file contains a function providing the desired system.
 *  Specifically, this is a watertank system with two side_tank on the top,
 *  one bottom_tank at the bottom and a valve on top of each of them.
+*  Any other tree of tanks can be built from a topology.
 *  For every valve there is also a controller regulating its opening
 *  and closing.
 *
@@ -28,7 +29,11 @@
 */
 
 #include <ariadne.h>
+#include "topology.h"
+#include "location-codec.h"
 #include "bottom_tank.h"
+#include "middle_tank.h"
+#include "held_input.h"
 #include "side_tank.h"
 #include "valve.h"
 #include "urgent-controller.h"
@@ -37,17 +42,83 @@
 
 namespace Ariadne {
 
-  HybridIOAutomaton getSystem() {
+  /*
+  * Builds the automaton of the k-th tank of the given plant: a side tank
+  * when no tank flows into it, a bottom tank when it flows into no tank,
+  * a middle tank otherwise.
+  */
+  HybridIOAutomaton getTreeTank(
+    const PlantTopology& topology,
+    int k,
+    const std::vector<RealVariable>& waterlevels,
+    const std::vector<RealVariable>& valvelevels,
+    const std::vector<RealParameter>& lowerflows){
+
+      std::vector<unsigned int> upstream = topology.upstream(k);
+      int downstream = topology.tanks.at(k).downstream;
+
+      if (upstream.empty()){
+        // Store of the input of the tank, constant.
+        RealParameter upperflow("w" + Ariadne::to_string(k) + "in",topology.tanks.at(k).input_flow);
+        return Ariadne::getSideTank(
+          waterlevels.at(k),
+          valvelevels.at(k),
+          valvelevels.at(downstream),
+          upperflow,
+          lowerflows.at(k),
+          // This int represents the number of this tank.
+          k
+        );
+      }
+
+      // The tanks flowing into this one.
+      std::vector<RealVariable> upper_waterlevels;
+      std::vector<RealParameter> upper_output_flows;
+      for (unsigned int i = 0; i < upstream.size(); i++){
+        upper_waterlevels.push_back(waterlevels.at(upstream.at(i)));
+        upper_output_flows.push_back(lowerflows.at(upstream.at(i)));
+      }
+
+      if (downstream < 0){
+        return Ariadne::getBottomTank(
+          waterlevels.at(k),
+          upper_waterlevels,
+          valvelevels.at(k),
+          upper_output_flows,
+          lowerflows.at(k),
+          // This int represents the number of this tank.
+          k
+        );
+      }
+
+      return Ariadne::getMiddleTank(
+        waterlevels.at(k),
+        upper_waterlevels,
+        valvelevels.at(k),
+        valvelevels.at(downstream),
+        upper_output_flows,
+        lowerflows.at(k),
+        // This int represents the number of this tank.
+        k
+      );
+    }
+
+  /*
+  * Builds the system for the given plant: a tank, a valve and a controller
+  * for each tank of the topology, urgent or not as set by the topology.
+  * The verbosity is used to report how many locations of the full
+  * product have been removed by the composition.
+  */
+  HybridIOAutomaton getSystem(const PlantTopology& topology, int verbosity) {
 
-    // Integer that counts the tanks.
-    int tank_counter = 0;
+    topology.check();
 
     // Number of the tanks.
-    int tank_number = 3;
+    int tank_number = topology.size();
     // Number of the valves.
-    int valve_number = 3;
+    int valve_number = tank_number;
     // Number of the controllers.
-    int controller_number = 3;
+    int controller_number = tank_number;
 
     /*
     * Creation of a Vector of Pairs containing
@@ -73,64 +144,30 @@ namespace Ariadne {
 
     // 0: Parameters.
 
-    // Creation of a vector<RealVariables> for the upper tanks' inputs.
-    std::vector<RealParameter> upperflows;
-
-    // Store of the input of the watertank 0, constant.
-    upperflows.push_back(RealParameter("w0in",0.5));
-    // Store of the input of the watertank 1, constant.
-    upperflows.push_back(RealParameter("w1in",0.5));
-
-    // Creation of a vector<RealParameter> for the tanks' output diameter.
+    // Creation of a vector<RealParameter> for the tanks' output diameter, one for each tank.
     std::vector<RealParameter> lowerflows;
+    for (int k = 0; k < tank_number; k++){
+      lowerflows.push_back(RealParameter("tankOutputFlow" + Ariadne::to_string(k),topology.tanks.at(k).output_flow));
+    }
 
-    // Store of the three parameters, one for each tank.
-    lowerflows.push_back(RealParameter("tankOutputFlow0",0.04));
-    lowerflows.push_back(RealParameter("tankOutputFlow1",0.04));
-    lowerflows.push_back(RealParameter("tankOutputFlow2",0.04));
+    // 1. Automata
 
-    // Creation of the two top tanks.
-    for (int k = 0; k < 2; k++){
-      HybridIOAutomaton local_tank = Ariadne::getSideTank(
-        waterlevels.at(k),
-        valvelevels.at(k),
-        valvelevels.at(2),
-        upperflows.at(k),
-        lowerflows.at(k),
-        // This int represents the number of this tank.
-        tank_counter
-      );
+    for (int k = 0; k < tank_number; k++){
+      HybridIOAutomaton local_tank = getTreeTank(topology, k, waterlevels, valvelevels, lowerflows);
       pair<HybridIOAutomaton,DiscreteLocation> pair (local_tank, "flow" + Ariadne::to_string(k));
       mainVector.push_back(pair);
-      tank_counter++;
     }
 
-    // Creation of the bottom tank.
-    HybridIOAutomaton real_bottom_tank = Ariadne::getBottomTank(
-      waterlevels.at(2),
-      waterlevels.at(0),
-      waterlevels.at(1),
-      valvelevels.at(2),
-      lowerflows.at(0),
-      lowerflows.at(1),
-      lowerflows.at(2),
-      // This int represents the number of this tank.
-      tank_counter
-    );
-
-    pair<HybridIOAutomaton,DiscreteLocation> bottom_tank_pair (real_bottom_tank, DiscreteLocation("flow2"));
-    mainVector.push_back(bottom_tank_pair);
-
     /// Valve automata
 
     // 0. Parameters
 
     // Time constant for opening/closing the valves.
-    RealParameter T("T",4.0);
+    RealParameter T("T",topology.opening_time);
 
     // 1. Automaton
 
-    // Creation of three valves.
+    // Creation of the valves.
     for (int k = 0; k < valve_number; k++){
       HybridIOAutomaton valve = Ariadne::getValve(
         // Valve's opening time.
@@ -152,32 +189,130 @@ namespace Ariadne {
     * The parameters checked by the controllers.
     * In this version we considerd them identical for every tank.
     */
-    RealParameter hmin("hmin",5.75); // Lower threshold
-    RealParameter hmax("hmax",7.75); // Upper threshold
-    RealParameter delta("delta",0.002); // Indetermination constant
+    RealParameter hmin("hmin",topology.hmin); // Lower threshold
+    RealParameter hmax("hmax",topology.hmax); // Upper threshold
+    RealParameter delta("delta",topology.delta); // Indetermination constant
 
     // 1. Automata
 
-    // Creation of three controllers.
+    // Creation of the controllers.
     for (int k = 0; k < controller_number; k++){
-      HybridIOAutomaton controller = Ariadne::getUrgentController(
-        // Controlled tank's waterlevel.
-        waterlevels.at(k),
-        hmin,hmax,//delta,
-        // Controlled tank's valve
-        std::get<0>(mainVector.at(tank_number + k)),
-        // This int represents the number of this component.
-        k
-      );
+      HybridIOAutomaton controller = (topology.urgent_controllers ?
+        Ariadne::getUrgentController(
+          // Controlled tank's waterlevel.
+          waterlevels.at(k),
+          hmin,hmax,
+          // Controlled tank's valve
+          std::get<0>(mainVector.at(tank_number + k)),
+          // This int represents the number of this component.
+          k
+        ) :
+        Ariadne::getController(
+          waterlevels.at(k),
+          hmin,hmax,delta,
+          std::get<0>(mainVector.at(tank_number + k)),
+          k
+        ));
       pair<HybridIOAutomaton,DiscreteLocation> pair (controller, "rising" + Ariadne::to_string(k));
       mainVector.push_back(pair);
     }
 
     // Composition of all the automata in order to get a single one.
-    HybridIOAutomaton system = composition_all_pieces_together(mainVector);
+    HybridIOAutomaton system = composition_all_pieces_together(mainVector,verbosity);
 
     return system;
 
   }
 
+  // The original plant, with two side tanks flowing into a bottom tank.
+  HybridIOAutomaton getSystem(int verbosity = 0) {
+    return getSystem(getPyramidTopology(),verbosity);
+  }
+
+  /*
+  * Builds the subsystem of the k-th tank of the given plant, i.e. the tank
+  * along with its valve and its controller. The variables the tank
+  * reads from the rest of the plant (the water levels of the upper tanks and
+  * the valve level of the lower tank) are provided by held inputs, and they
+  * are appended to the inputs vector. The initial location is returned in
+  * initial_location.
+  */
+  HybridIOAutomaton getTankSubsystem(
+    const PlantTopology& topology,
+    int k,
+    std::vector<RealVariable>& inputs,
+    DiscreteLocation& initial_location) {
+
+    topology.check();
+
+    int tank_number = topology.size();
+
+    // The variables of the whole plant, though only a few are used here.
+    std::vector<RealVariable> waterlevels;
+    std::vector<RealVariable> valvelevels;
+    std::vector<RealParameter> lowerflows;
+    for (int i = 0; i < tank_number; i++){
+      waterlevels.push_back(RealVariable("waterLevel" + Ariadne::to_string(i)));
+      valvelevels.push_back(RealVariable("valveLevel" + Ariadne::to_string(i)));
+      lowerflows.push_back(RealParameter("tankOutputFlow" + Ariadne::to_string(i),topology.tanks.at(i).output_flow));
+    }
+
+    String number = Ariadne::to_string(k);
+    std::vector< pair<HybridIOAutomaton,DiscreteLocation> > mainVector;
+
+    // The tank, its valve and its controller.
+    mainVector.push_back(make_pair(getTreeTank(topology, k, waterlevels, valvelevels, lowerflows),DiscreteLocation("flow" + number)));
+    HybridIOAutomaton valve = Ariadne::getValve(RealParameter("T",topology.opening_time), valvelevels.at(k), k);
+    mainVector.push_back(make_pair(valve,DiscreteLocation("idle_" + number)));
+    RealParameter hmin("hmin",topology.hmin), hmax("hmax",topology.hmax);
+    HybridIOAutomaton controller = (topology.urgent_controllers ?
+      Ariadne::getUrgentController(waterlevels.at(k), hmin, hmax, valve, k) :
+      Ariadne::getController(waterlevels.at(k), hmin, hmax, RealParameter("delta",topology.delta), valve, k));
+    mainVector.push_back(make_pair(controller,DiscreteLocation("rising" + number)));
+
+    // The inputs from the rest of the plant.
+    std::vector<unsigned int> upstream = topology.upstream(k);
+    for (unsigned int i = 0; i < upstream.size(); i++){
+      inputs.push_back(waterlevels.at(upstream.at(i)));
+    }
+    if (!topology.is_bottom(k)){
+      inputs.push_back(valvelevels.at(topology.tanks.at(k).downstream));
+    }
+    for (unsigned int i = 0; i < inputs.size(); i++){
+      mainVector.push_back(make_pair(getHeldInput(inputs.at(i)),DiscreteLocation("hold_" + inputs.at(i).name())));
+    }
+
+    String location_name = std::get<1>(mainVector.at(0)).name();
+    for (unsigned int i = 1; i < mainVector.size(); i++){
+      location_name += "," + std::get<1>(mainVector.at(i)).name();
+    }
+    initial_location = DiscreteLocation(location_name);
+
+    return composition_all_pieces_together(mainVector);
+  }
+
+  /*
+  * The initial location of the system for the given plant, where every tank
+  * is flowing, every valve is idle and every controller is rising.
+  */
+  DiscreteLocation getInitialLocation(const PlantTopology& topology) {
+    LocationCodec codec(topology.size());
+    return DiscreteLocation(codec.name(codec.initial()));
+  }
+
+  /*
+  * A box over all the variables of the system for the given number of tanks,
+  * with the same ranges for every valve level and for every water level.
+  * The variables are ordered alphabetically, hence all the valve levels
+  * come before all the water levels.
+  */
+  Box getTankBox(unsigned int tank_number, Interval valvelevel, Interval waterlevel) {
+    Box box(2*tank_number);
+    for (unsigned int k = 0; k < tank_number; k++){
+      box[k] = valvelevel;
+      box[tank_number + k] = waterlevel;
+    }
+    return box;
+  }
+
 }
@@ -0,0 +1,144 @@
+/***************************************************************************
+*            bdd-cell-set-test.cc
+*
+*  Checks the sets of grid cells stored as decision diagrams: the cells
+*  of the boxes adjoined must be counted and listed back exactly, with
+*  the outer and the inner rounding, and union, intersection and
+*  inclusion must agree with the explicit sets of cells.
+*  It is built only when BuDDy is found.
+*
+*  Copyright  2018  Raffaello Corsini, Luca Geretti
+*
+****************************************************************************/
+
+/*
+*  This program is free software; you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation; either version 2 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Library General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program; if not, write to the Free Software
+*  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#include <iostream>
+#include <random>
+#include <set>
+#include <tuple>
+#include "../bdd-cell-set.h"
+
+using namespace Ariadne;
+
+// A cell of the grid: its location and the integer coordinates of its lower corner
+typedef std::tuple<std::string,long,long> Cell;
+
+// The grid of the tests: [0,8]x[0,4] in 2^3 intervals along each dimension
+const double lower_bounds[] = { 0.0, 0.0 };
+const double upper_bounds[] = { 8.0, 4.0 };
+const unsigned int bits = 3;
+
+// The explicit cells of a box with the given rounding
+std::set<Cell> explicit_cells(const std::string& location, const std::vector<double>& lower, const std::vector<double>& upper, BddRounding rounding) {
+  std::set<Cell> cells;
+  long cells_per_dimension = 1l << bits;
+  for (long i = 0; i < cells_per_dimension; i++) {
+    for (long j = 0; j < cells_per_dimension; j++) {
+      double width[] = { upper_bounds[0] / cells_per_dimension, upper_bounds[1] / cells_per_dimension };
+      double cell_lower[] = { i * width[0], j * width[1] }, cell_upper[] = { (i + 1) * width[0], (j + 1) * width[1] };
+      bool intersects = true, contained = true;
+      for (unsigned int d = 0; d < 2; d++) {
+        intersects = intersects && cell_upper[d] > lower[d] && cell_lower[d] < upper[d];
+        contained = contained && cell_lower[d] >= lower[d] && cell_upper[d] <= upper[d];
+      }
+      if (rounding == BDD_OUTER ? intersects : contained)
+        cells.insert(Cell(location,i,j));
+    }
+  }
+  return cells;
+}
+
+// The explicit cells listed by a set
+std::set<Cell> listed_cells(const BddCellSet& set) {
+  std::set<Cell> cells;
+  unsigned int failures = 0;
+  set.for_each_box([&](const std::string& location, const std::vector<double>& lower, const std::vector<double>& upper) {
+    std::set<Cell> box = explicit_cells(location,lower,upper,BDD_INNER);
+    if (box.empty())
+      failures++;
+    cells.insert(box.begin(),box.end());
+  });
+  if (failures > 0)
+    cells.insert(Cell("empty box",0,0));
+  return cells;
+}
+
+// Checks random sets of random boxes, returning the number of mismatches with the explicit cells
+unsigned int check(unsigned int sets, std::mt19937_64& generator) {
+  std::vector<double> lower(lower_bounds,lower_bounds + 2), upper(upper_bounds,upper_bounds + 2);
+  std::shared_ptr<BddCellEncoding> encoding = std::make_shared<BddCellEncoding>(lower,upper,bits,3);
+  std::uniform_real_distribution<double> unit(0.0,1.0);
+  std::uniform_int_distribution<int> location(0,2), coin(0,1), count(1,4);
+
+  unsigned int failures = 0;
+  for (unsigned int s = 0; s < sets; s++) {
+    BddCellSet first(encoding), second(encoding);
+    std::set<Cell> first_cells, second_cells;
+    for (unsigned int which = 0; which < 2; which++) {
+      int boxes = count(generator);
+      for (int b = 0; b < boxes; b++) {
+        std::string name = "location" + std::to_string(location(generator));
+        std::vector<double> box_lower(2), box_upper(2);
+        for (unsigned int d = 0; d < 2; d++) {
+          double a = upper_bounds[d] * unit(generator), c = upper_bounds[d] * unit(generator);
+          box_lower[d] = std::min(a,c);
+          box_upper[d] = std::max(a,c);
+        }
+        BddRounding rounding = (coin(generator) ? BDD_OUTER : BDD_INNER);
+        std::set<Cell> cells = explicit_cells(name,box_lower,box_upper,rounding);
+        (which == 0 ? first : second).adjoin(name,box_lower,box_upper,rounding);
+        (which == 0 ? first_cells : second_cells).insert(cells.begin(),cells.end());
+      }
+    }
+
+    if (first.cell_count() != first_cells.size() || listed_cells(first) != first_cells || first.empty() != first_cells.empty()) {
+      if (failures < 5)
+        std::cout << "A set of " << first_cells.size() << " cells counts " << first.cell_count() << " cells." << std::endl;
+      failures++;
+    }
+
+    std::set<Cell> union_cells = first_cells, intersection_cells;
+    union_cells.insert(second_cells.begin(),second_cells.end());
+    for (std::set<Cell>::const_iterator it = first_cells.begin(); it != first_cells.end(); ++it) {
+      if (second_cells.count(*it))
+        intersection_cells.insert(*it);
+    }
+    bool subset = (intersection_cells == first_cells);
+
+    BddCellSet union_set = first, intersection_set = first;
+    union_set.adjoin(second);
+    intersection_set.restrict(second);
+    if (listed_cells(union_set) != union_cells || listed_cells(intersection_set) != intersection_cells || first.subset(second) != subset) {
+      if (failures < 5)
+        std::cout << "The union, intersection or inclusion of two sets differs from that of their cells." << std::endl;
+      failures++;
+    }
+  }
+  return failures;
+}
+
+int main() {
+  std::mt19937_64 generator(0);
+  unsigned int failures = check(500,generator);
+  if (failures > 0) {
+    std::cout << failures << " sets differ from their cells." << std::endl;
+    return 1;
+  }
+  std::cout << "All the sets match their cells." << std::endl;
+  return 0;
+}
@@ -0,0 +1,143 @@
+/***************************************************************************
+*            dynamics-kernel-test.cc
+*
+*  Checks that the interval kernel of the plant dynamics is sound: for
+*  random boxes of random plants, the derivative at points of each box,
+*  evaluated in extended precision, must lie within the bounds computed
+*  by the kernel, both with and without the AVX2 path.
+*
+*  Copyright  2018  Raffaello Corsini, Luca Geretti
+*
+****************************************************************************/
+
+/*
+*  This program is free software; you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation; either version 2 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Library General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program; if not, write to the Free Software
+*  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#include <cfloat>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include "../dynamics-kernel.h"
+
+using namespace Ariadne;
+
+// The derivative of variable i at a point, in extended precision, along with a bound on the error of its
+// evaluation: the variables are ordered as in a BoxBatch
+long double reference_derivative(const PlantTopology& topology, const std::vector<ValveMode>& valves, const std::vector<long double>& y,
+    unsigned int i, long double& error) {
+  unsigned int n = topology.size();
+  if (i >= n) {
+    unsigned int k = i - n;
+    error = 0.0;
+    return (valves[k] == VALVE_IDLE ? 0.0L : (valves[k] == VALVE_OPENING ? 1.0L : -1.0L) / topology.opening_time);
+  }
+  unsigned int k = i;
+  const TankDescription& tank = topology.tanks[k];
+  std::vector<unsigned int> upstream = topology.upstream(k);
+  std::vector<long double> terms;
+  if (upstream.empty()) {
+    terms.push_back((long double)tank.input_flow * y[n + k]);
+  } else {
+    for (unsigned int u = 0; u < upstream.size(); u++)
+      terms.push_back((long double)(0.5*topology.tanks[upstream[u]].output_flow) * y[n + k] * y[upstream[u]]);
+  }
+  if (tank.downstream < 0)
+    terms.push_back(-(long double)tank.output_flow * y[k]);
+  else
+    terms.push_back(-(long double)(0.5*tank.output_flow) * y[n + tank.downstream] * y[k]);
+  long double sum = 0.0, magnitude = 0.0;
+  for (unsigned int t = 0; t < terms.size(); t++) {
+    sum += terms[t];
+    magnitude += std::fabs(terms[t]);
+  }
+  error = 8 * LDBL_EPSILON * magnitude;
+  return sum;
+}
+
+// Checks the kernel over random batches of boxes of a plant, returning the number of unsound bounds
+unsigned long check(const PlantTopology& topology, bool avx2, unsigned int batches, unsigned int boxes, std::mt19937_64& generator) {
+  unsigned int n = topology.size();
+  DynamicsKernel kernel(topology);
+  kernel.set_use_avx2(avx2);
+  std::uniform_real_distribution<double> unit(0.0,1.0);
+  std::uniform_int_distribution<int> mode(0,2), coin(0,1), scale(0,5);
+  const double widths[] = { 0.0, 1e-15, 1e-9, 1e-4, 0.1, 1.0 };
+
+  unsigned long failures = 0;
+  for (unsigned int b = 0; b < batches; b++) {
+    std::vector<ValveMode> valves(n);
+    for (unsigned int k = 0; k < n; k++)
+      valves[k] = (ValveMode)mode(generator);
+    BoxBatch batch(2*n,boxes), derivatives(2*n,boxes);
+    for (unsigned int i = 0; i < 2*n; i++) {
+      for (unsigned int j = 0; j < boxes; j++) {
+        // Water levels mostly in the domain, valve levels in [0,1], some of them negative
+        double centre = (i < n ? 4.5 + 4.5*unit(generator) : unit(generator));
+        if (scale(generator) == 0)
+          centre = -centre;
+        double width = widths[scale(generator)] * unit(generator);
+        batch.lower(i)[j] = centre - width;
+        batch.upper(i)[j] = centre + width;
+      }
+    }
+    kernel.evaluate(valves,batch,derivatives);
+
+    for (unsigned int j = 0; j < boxes; j++) {
+      for (unsigned int i = 0; i < 2*n; i++) {
+        if (derivatives.lower(i)[j] > derivatives.upper(i)[j])
+          failures++;
+      }
+      // Random vertices, then random points of the box
+      for (unsigned int p = 0; p < 6; p++) {
+        std::vector<long double> y(2*n);
+        for (unsigned int i = 0; i < 2*n; i++) {
+          long double lower = batch.lower(i)[j], upper = batch.upper(i)[j];
+          y[i] = (p < 4 ? (coin(generator) ? lower : upper) : lower + (upper - lower) * (long double)unit(generator));
+        }
+        for (unsigned int i = 0; i < 2*n; i++) {
+          long double error;
+          long double value = reference_derivative(topology,valves,y,i,error);
+          if (value + error < derivatives.lower(i)[j] || value - error > derivatives.upper(i)[j]) {
+            if (failures < 5)
+              std::cerr << "Unsound bound of variable " << i << " of a plant of " << n << " tanks: [" << derivatives.lower(i)[j] << ","
+                        << derivatives.upper(i)[j] << "] does not contain " << (double)value << std::endl;
+            failures++;
+          }
+        }
+      }
+    }
+  }
+  return failures;
+}
+
+int main() {
+  std::cout.precision(17);
+  std::cerr.precision(17);
+  std::mt19937_64 generator(0);
+  unsigned long failures = 0;
+  const unsigned int sizes[] = { 2, 3, 7, 15 };
+  for (unsigned int s = 0; s < 4; s++) {
+    failures += check(getBinaryTreeTopology(sizes[s]),false,25,1001,generator);
+    failures += check(getBinaryTreeTopology(sizes[s]),true,25,1001,generator);
+    failures += check(getCascadeTopology(sizes[s]),false,25,1001,generator);
+  }
+  if (failures > 0) {
+    std::cout << failures << " unsound bounds." << std::endl;
+    return 1;
+  }
+  std::cout << "All the bounds are sound." << std::endl;
+  return 0;
+}
@@ -0,0 +1,103 @@
+/***************************************************************************
+*            outcome-database-test.cc
+*
+*  Checks the database of the parametric outcomes: the outcomes stored
+*  must be read back by a later database on the same file, with their
+*  bounds exact, a safe box must make its sub-boxes safe, an unsafe box
+*  must be reused only for the same box, and the undecided boxes and
+*  the boxes of other contexts must never be reused.
+*
+*  Copyright  2018  Raffaello Corsini, Luca Geretti
+*
+****************************************************************************/
+
+/*
+*  This program is free software; you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation; either version 2 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Library General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program; if not, write to the Free Software
+*  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#include <cstdio>
+#include <iostream>
+#include "../outcome-database.h"
+
+using namespace Ariadne;
+
+const std::string filename = "outcome-database-test.db";
+
+StoredBox box(double hmin_lower, double hmin_upper, double hmax_lower, double hmax_upper) {
+  StoredBox result;
+  result.names.push_back("hmin");
+  result.lower.push_back(hmin_lower);
+  result.upper.push_back(hmin_upper);
+  result.names.push_back("hmax");
+  result.lower.push_back(hmax_lower);
+  result.upper.push_back(hmax_upper);
+  return result;
+}
+
+// Checks the lookups on the given database, returning the number of failures
+unsigned int check_lookups(OutcomeDatabase& database, const std::string& which) {
+  struct Lookup {
+    std::string context;
+    StoredBox box;
+    StoredOutcome expected;
+  };
+  const double third = 1.0/3;
+  Lookup lookups[] = {
+    // Inside the safe box, with bounds which are not decimal
+    { "plant", box(5.0 + third,5.5,7.0,7.0 + third), OUTCOME_SAFE },
+    { "plant", box(5.0,6.0,7.0,8.0), OUTCOME_SAFE },
+    // Across the bound of the safe box
+    { "plant", box(4.9,5.5,7.0,7.5), OUTCOME_UNDECIDED },
+    // The unsafe box, and a sub-box of it
+    { "plant", box(0.1,0.2,0.3,0.4), OUTCOME_UNSAFE },
+    { "plant", box(0.1,0.15,0.3,0.4), OUTCOME_UNDECIDED },
+    // Inside the undecided box
+    { "plant", box(2.5,2.6,3.5,3.6), OUTCOME_UNDECIDED },
+    // The safe box in another context
+    { "other", box(5.0,6.0,7.0,8.0), OUTCOME_UNDECIDED },
+  };
+  unsigned int failures = 0;
+  for (unsigned int l = 0; l < sizeof(lookups)/sizeof(Lookup); l++) {
+    StoredOutcome outcome = database.lookup(lookups[l].context,lookups[l].box);
+    if (outcome != lookups[l].expected) {
+      std::cout << "Lookup " << l << " on the " << which << " database gives " << outcome << " instead of " << lookups[l].expected << "." << std::endl;
+      failures++;
+    }
+  }
+  return failures;
+}
+
+int main() {
+  std::remove(filename.c_str());
+  unsigned int failures = 0;
+  {
+    OutcomeDatabase database(filename);
+    database.store("plant",box(5.0,6.0,7.0,8.0),OUTCOME_SAFE);
+    database.store("plant",box(0.1,0.2,0.3,0.4),OUTCOME_UNSAFE);
+    database.store("plant",box(2.0,3.0,3.0,4.0),OUTCOME_UNDECIDED);
+    failures += check_lookups(database,"storing");
+  }
+  {
+    OutcomeDatabase database(filename);
+    failures += check_lookups(database,"reloaded");
+  }
+  std::remove(filename.c_str());
+  if (failures > 0) {
+    std::cout << failures << " failed checks." << std::endl;
+    return 1;
+  }
+  std::cout << "All the outcomes are reused as expected." << std::endl;
+  return 0;
+}
@@ -0,0 +1,158 @@
+/***************************************************************************
+*            reach-stream-test.cc
+*
+*  Checks the reach streams: the boxes written from several threads must
+*  be read back exactly, each one with its kind and its location, and
+*  the boxes of the wrong dimension, the files which are not streams and
+*  the truncated streams must be rejected with an exception.
+*
+*  Copyright  2018  Raffaello Corsini, Luca Geretti
+*
+****************************************************************************/
+
+/*
+*  This program is free software; you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation; either version 2 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Library General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program; if not, write to the Free Software
+*  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#include <cstdio>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <set>
+#include <thread>
+#include "../reach-stream.h"
+
+using namespace Ariadne;
+
+const std::string filename = "reach-stream-test.reach";
+
+// A box as a comparable tuple of its kind, location and bounds
+typedef std::pair< std::pair<int,std::string>, std::vector<double> > BoxKey;
+
+BoxKey key(ReachBoxKind kind, const std::string& location, const std::vector<double>& lower, const std::vector<double>& upper) {
+  std::vector<double> bounds(lower);
+  bounds.insert(bounds.end(),upper.begin(),upper.end());
+  return BoxKey(std::make_pair((int)kind,location),bounds);
+}
+
+// Writes random boxes from several threads, then reads them back, returning the number of failures
+unsigned int check_round_trip(unsigned int dimension, unsigned int threads, unsigned int boxes) {
+  std::multiset<BoxKey> written;
+  std::vector< std::multiset<BoxKey> > written_by_thread(threads);
+  {
+    ReachStreamWriter writer(filename,dimension);
+    std::vector<std::thread> workers;
+    for (unsigned int t = 0; t < threads; t++) {
+      workers.push_back(std::thread([&,t]() {
+        std::mt19937_64 generator(t);
+        std::uniform_real_distribution<double> value(-10.0,10.0);
+        std::uniform_int_distribution<int> location(0,20), coin(0,1);
+        for (unsigned int b = 0; b < boxes; b++) {
+          std::vector<double> lower(dimension), upper(dimension);
+          for (unsigned int i = 0; i < dimension; i++) {
+            lower[i] = value(generator);
+            upper[i] = lower[i] + 1.0/(1 + b);
+          }
+          ReachBoxKind kind = (coin(generator) ? REACH_ENCLOSURE : REACH_CELL);
+          std::string name = "flow" + std::to_string(location(generator)) + ",idle_0";
+          writer.write(kind,name,lower,upper);
+          written_by_thread[t].insert(key(kind,name,lower,upper));
+        }
+      }));
+    }
+    for (unsigned int t = 0; t < threads; t++) {
+      workers[t].join();
+      written.insert(written_by_thread[t].begin(),written_by_thread[t].end());
+    }
+    if (writer.size() != threads * boxes) {
+      std::cout << "The writer counts " << writer.size() << " boxes instead of " << threads * boxes << "." << std::endl;
+      return 1;
+    }
+  }
+
+  ReachStreamReader reader(filename);
+  std::multiset<BoxKey> read;
+  ReachBox box;
+  while (reader.next(box))
+    read.insert(key(box.kind,box.location,box.lower,box.upper));
+  if (reader.dimension() != dimension || read != written) {
+    std::cout << "The " << read.size() << " boxes read differ from the " << written.size() << " boxes written." << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+// Whether the function throws the given exception type
+template<class E, class F> bool throws(const F& function) {
+  try {
+    function();
+  } catch (E&) {
+    return true;
+  }
+  return false;
+}
+
+// Checks that the misuses of the streams are reported, returning the number of failures
+unsigned int check_errors() {
+  unsigned int failures = 0;
+
+  if (!throws<std::invalid_argument>([]() {
+        ReachStreamWriter writer(filename,2);
+        writer.write(REACH_CELL,"flow0",std::vector<double>(3,0.0),std::vector<double>(3,1.0));
+      })) {
+    std::cout << "A box of the wrong dimension is written." << std::endl;
+    failures++;
+  }
+
+  {
+    std::ofstream file(filename.c_str(),std::ios::binary | std::ios::trunc);
+    file << "not a reach stream";
+  }
+  if (!throws<std::runtime_error>([]() { ReachStreamReader reader(filename); })) {
+    std::cout << "A file which is not a reach stream is read." << std::endl;
+    failures++;
+  }
+
+  // A stream cut within the bounds of its only box
+  {
+    ReachStreamWriter writer(filename,4);
+    writer.write(REACH_ENCLOSURE,"flow0",std::vector<double>(4,0.0),std::vector<double>(4,1.0));
+  }
+  {
+    std::ifstream file(filename.c_str(),std::ios::binary);
+    std::string content((std::istreambuf_iterator<char>(file)),std::istreambuf_iterator<char>());
+    std::ofstream truncated(filename.c_str(),std::ios::binary | std::ios::trunc);
+    truncated.write(content.data(),content.size() - 12);
+  }
+  if (!throws<std::runtime_error>([]() { ReachStreamReader reader(filename); ReachBox box; while (reader.next(box)) { } })) {
+    std::cout << "A truncated reach stream is read." << std::endl;
+    failures++;
+  }
+  return failures;
+}
+
+int main() {
+  unsigned int failures = 0;
+  failures += check_round_trip(6,1,1000);
+  failures += check_round_trip(22,4,1000);
+  failures += check_errors();
+  std::remove(filename.c_str());
+  if (failures > 0) {
+    std::cout << failures << " failed checks." << std::endl;
+    return 1;
+  }
+  std::cout << "All the reach streams are read back." << std::endl;
+  return 0;
+}
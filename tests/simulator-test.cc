@@ -0,0 +1,109 @@
+/***************************************************************************
+*            simulator-test.cc
+*
+*  Checks the native simulator of the plant: a controller threshold which
+*  is crossed and crossed back within a single step must still switch the
+*  controller, and the closed form flow must take the same events at the
+*  same times as the integrated one.
+*
+*  Copyright  2018  Raffaello Corsini, Luca Geretti
+*
+****************************************************************************/
+
+/*
+*  This program is free software; you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation; either version 2 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Library General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program; if not, write to the Free Software
+*  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#include <cmath>
+#include <iostream>
+#include "../simulator.h"
+
+using namespace Ariadne;
+
+// Two tanks in a cascade, the upper one full with its valve closed: the level of the lower tank rises
+// over hmax and falls back below it by time 8, with its maximum of about 2.89 at time 1.77
+PlantTopology getOvershootTopology() {
+  PlantTopology topology = getCascadeTopology(2);
+  topology.tanks[0].output_flow = 0.5;
+  topology.tanks[1].output_flow = 0.5;
+  topology.hmin = 0.5;
+  topology.hmax = 2.8;
+  return topology;
+}
+
+PlantState getOvershootState(const PlantSimulator& simulator) {
+  PlantState state = simulator.initial_state();
+  state.levels[0] = 9.0;
+  state.levels[1] = 2.0;
+  state.levels[2] = 0.0;
+  state.controllers[0] = CONTROLLER_FALLING;
+  return state;
+}
+
+// The time of the first event with the given name, or a negative time if none was taken
+double event_time(const SimulationResult& result, const std::string& name) {
+  for (unsigned int e = 0; e < result.events.size(); e++) {
+    if (result.events[e].name == name)
+      return result.events[e].time;
+  }
+  return -1.0;
+}
+
+// Checks that a single closed form step over the whole horizon finds the crossing within it
+unsigned int check_crossing_within_step() {
+  PlantSimulator simulator(getOvershootTopology());
+  SimulationSettings settings;
+  settings.horizon = 8.0;
+  settings.maximum_step_size = 8.0;
+  settings.closed_form_step_size = 8.0;
+  SimulationResult result = simulator.simulate(getOvershootState(simulator),settings);
+  double time = event_time(result,"e_close_1");
+  if (time < 0.0 || time > 1.77) {
+    std::cout << "The crossing of hmax within a closed form step was not found at the right time: " << time << "." << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+// Checks that the closed form and the integrated flows switch the controller at the same time
+unsigned int check_closed_form_matches_integration() {
+  PlantSimulator simulator(getOvershootTopology());
+  SimulationSettings settings;
+  settings.horizon = 8.0;
+  settings.closed_form_step_size = 0.5;
+  SimulationResult closed_form = simulator.simulate(getOvershootState(simulator),settings);
+  settings.closed_form = false;
+  SimulationResult integrated = simulator.simulate(getOvershootState(simulator),settings);
+  double closed_form_time = event_time(closed_form,"e_close_1"), integrated_time = event_time(integrated,"e_close_1");
+  if (closed_form.closed_form_steps == 0 || integrated.closed_form_steps != 0 || closed_form_time < 0.0
+      || std::fabs(closed_form_time - integrated_time) > 1e-6) {
+    std::cout << "The closed form flow switches at " << closed_form_time << ", the integrated one at " << integrated_time << "." << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+int main() {
+  std::cout.precision(17);
+  unsigned int failures = 0;
+  failures += check_crossing_within_step();
+  failures += check_closed_form_matches_integration();
+  if (failures > 0) {
+    std::cout << failures << " failed checks." << std::endl;
+    return 1;
+  }
+  std::cout << "All the simulations switch where expected." << std::endl;
+  return 0;
+}
@@ -0,0 +1,142 @@
+/***************************************************************************
+*            symmetry-test.cc
+*
+*  Checks the symmetries of the plants: the number of equivalent states
+*  of binary trees, the lack of any symmetry in cascades and in trees
+*  whose branches differ in their parameters, and, for random states of
+*  symmetric trees, that every canonical permutation maps the plant onto
+*  itself and that all the images of a state have the same canonical
+*  representative.
+*
+*  Copyright  2018  Raffaello Corsini, Luca Geretti
+*
+****************************************************************************/
+
+/*
+*  This program is free software; you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation; either version 2 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Library General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program; if not, write to the Free Software
+*  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#include <iostream>
+#include <random>
+#include "../symmetry.h"
+
+using namespace Ariadne;
+
+// The signatures of the canonical representative of a state
+std::vector<std::string> canonical(const PlantSymmetry& symmetry, const std::vector<std::string>& signatures) {
+  std::vector<unsigned int> permutation = symmetry.canonical_permutation(signatures);
+  std::vector<std::string> result(signatures.size());
+  for (unsigned int k = 0; k < signatures.size(); k++)
+    result[k] = signatures[permutation[k]];
+  return result;
+}
+
+// Maps the branch ending in tank k onto the branch ending in tank image, randomly swapping the two upper
+// branches of each tank, which must have the same shape as in a full binary tree
+void random_image(const PlantTopology& topology, unsigned int k, unsigned int image, std::vector<unsigned int>& mapping, std::mt19937_64& generator) {
+  mapping[k] = image;
+  std::vector<unsigned int> upper = topology.upstream(k), image_upper = topology.upstream(image);
+  if (upper.size() == 2 && std::uniform_int_distribution<int>(0,1)(generator))
+    std::swap(image_upper[0],image_upper[1]);
+  for (unsigned int i = 0; i < upper.size(); i++)
+    random_image(topology,upper[i],image_upper[i],mapping,generator);
+}
+
+// Checks random states of a full binary tree of tanks, returning the number of failures
+unsigned int check_images(unsigned int tanks, unsigned int states, std::mt19937_64& generator) {
+  PlantTopology topology = getBinaryTreeTopology(tanks);
+  PlantSymmetry symmetry(topology);
+  std::uniform_int_distribution<int> mode(0,3);
+  unsigned int failures = 0;
+  for (unsigned int s = 0; s < states; s++) {
+    // Few distinct signatures, so that some branches have the same state
+    std::vector<std::string> signatures(tanks);
+    for (unsigned int k = 0; k < tanks; k++)
+      signatures[k] = std::to_string(mode(generator));
+    std::vector<unsigned int> mapping(tanks);
+    random_image(topology,tanks - 1,tanks - 1,mapping,generator);
+    std::vector<std::string> image(tanks);
+    for (unsigned int k = 0; k < tanks; k++)
+      image[mapping[k]] = signatures[k];
+    if (!symmetry.is_automorphism(mapping) || canonical(symmetry,signatures) != canonical(symmetry,image)) {
+      if (failures < 5)
+        std::cout << "An image of a state of a tree of " << tanks << " tanks has another canonical representative." << std::endl;
+      failures++;
+    }
+  }
+  return failures;
+}
+
+// Checks the plants which have no symmetry, returning the number of failures
+unsigned int check_asymmetric() {
+  unsigned int failures = 0;
+  for (unsigned int tanks = 2; tanks <= 12; tanks++) {
+    PlantSymmetry symmetry(getCascadeTopology(tanks));
+    std::vector<std::string> signatures(tanks);
+    for (unsigned int k = 0; k < tanks; k++)
+      signatures[k] = std::to_string(tanks - k);
+    std::vector<unsigned int> permutation = symmetry.canonical_permutation(signatures);
+    bool identity = true;
+    for (unsigned int k = 0; k < tanks; k++)
+      identity = identity && (permutation[k] == k);
+    if (symmetry.is_symmetric() || !identity) {
+      std::cout << "A cascade of " << tanks << " tanks is found symmetric." << std::endl;
+      failures++;
+    }
+  }
+
+  // Side tanks with different inputs, or with different outputs
+  PlantTopology inputs = getPyramidTopology(), outputs = getPyramidTopology();
+  inputs.tanks[0].input_flow = 0.6;
+  outputs.tanks[1].output_flow = 0.05;
+  if (PlantSymmetry(inputs).is_symmetric() || PlantSymmetry(outputs).is_symmetric()) {
+    std::cout << "A pyramid with different side tanks is found symmetric." << std::endl;
+    failures++;
+  }
+
+  // Swapping the side tanks of the pyramid, and not a side tank with the bottom one
+  PlantSymmetry pyramid(getPyramidTopology());
+  if (!pyramid.is_automorphism({1,0,2}) || pyramid.is_automorphism({2,1,0}) || pyramid.is_automorphism({0,0,2})
+      || PlantSymmetry(inputs).is_automorphism({1,0,2})) {
+    std::cout << "A permutation of the pyramid is misjudged." << std::endl;
+    failures++;
+  }
+  return failures;
+}
+
+int main() {
+  std::mt19937_64 generator(0);
+  unsigned int failures = 0;
+
+  // A full binary tree of depth d has 2^(2^(d-1)-1) equivalent states, swapping at each tank with upper tanks
+  const unsigned int sizes[] = { 3, 7, 15, 31 };
+  const double orders[] = { 2, 8, 128, 32768 };
+  for (unsigned int s = 0; s < 4; s++) {
+    PlantSymmetry symmetry(getBinaryTreeTopology(sizes[s]));
+    if (!symmetry.is_symmetric() || symmetry.order() != orders[s]) {
+      std::cout << "A tree of " << sizes[s] << " tanks has " << symmetry.order() << " equivalent states instead of " << orders[s] << "." << std::endl;
+      failures++;
+    }
+    failures += check_images(sizes[s],200,generator);
+  }
+  failures += check_asymmetric();
+
+  if (failures > 0) {
+    std::cout << failures << " failed checks." << std::endl;
+    return 1;
+  }
+  std::cout << "All the symmetries are found." << std::endl;
+  return 0;
+}
@@ -0,0 +1,122 @@
+/***************************************************************************
+*            work-stealing-pool-test.cc
+*
+*  Checks the pool of worker threads: every task, including those
+*  submitted by running tasks, must be run exactly once on a worker of
+*  the pool, the first exception thrown by a task must be rethrown by
+*  run() once the workers have stopped, and the pool must be usable
+*  again afterwards.
+*
+*  Copyright  2018  Raffaello Corsini, Luca Geretti
+*
+****************************************************************************/
+
+/*
+*  This program is free software; you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation; either version 2 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Library General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program; if not, write to the Free Software
+*  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#include <atomic>
+#include <iostream>
+#include <stdexcept>
+#include "../work-stealing-pool.h"
+
+using namespace Ariadne;
+
+// Submits a binary tree of tasks of the given depth from the running task, counting the tasks run
+// and the runs on a worker out of the pool
+void submit_tree(WorkStealingPool& pool, unsigned int worker, unsigned int depth, std::atomic<unsigned long>& runs, std::atomic<unsigned long>& misplaced) {
+  runs++;
+  if (worker >= pool.size())
+    misplaced++;
+  if (depth == 0)
+    return;
+  for (unsigned int i = 0; i < 2; i++) {
+    pool.submit(worker,[&,depth](WorkStealingPool& pool, unsigned int worker) {
+      submit_tree(pool,worker,depth - 1,runs,misplaced);
+    });
+  }
+}
+
+// Runs trees of tasks on a pool of the given size, returning the number of failures
+unsigned int check_trees(unsigned int workers) {
+  WorkStealingPool pool(workers);
+  std::atomic<unsigned long> runs(0), misplaced(0);
+  const unsigned int trees = 5, depth = 10;
+  for (unsigned int t = 0; t < trees; t++) {
+    pool.submit([&](WorkStealingPool& pool, unsigned int worker) {
+      submit_tree(pool,worker,depth,runs,misplaced);
+    });
+  }
+  pool.run();
+  unsigned long expected = trees * ((1ul << (depth + 1)) - 1);
+  if (runs != expected || misplaced != 0 || pool.size() != (workers == 0 ? 1 : workers)) {
+    std::cout << "A pool of " << workers << " workers ran " << runs << " tasks instead of " << expected
+              << ", " << misplaced << " of them on a missing worker." << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+// Checks that the exception of a task is rethrown, and that the pool runs again afterwards
+unsigned int check_exception(unsigned int workers) {
+  WorkStealingPool pool(workers);
+  std::atomic<unsigned long> runs(0);
+  for (unsigned int t = 0; t < 100; t++) {
+    pool.submit([&,t](WorkStealingPool&, unsigned int) {
+      runs++;
+      if (t == 50)
+        throw std::runtime_error("task 50");
+    });
+  }
+  bool thrown = false;
+  try {
+    pool.run();
+  } catch (std::runtime_error& ex) {
+    thrown = (std::string(ex.what()) == "task 50");
+  }
+  if (!thrown || runs > 100) {
+    std::cout << "A pool of " << workers << " workers did not rethrow the exception of its task." << std::endl;
+    return 1;
+  }
+
+  runs = 0;
+  for (unsigned int t = 0; t < 100; t++)
+    pool.submit([&](WorkStealingPool&, unsigned int) { runs++; });
+  try {
+    pool.run();
+  } catch (...) {
+    thrown = false;
+  }
+  if (!thrown || runs != 100) {
+    std::cout << "A pool of " << workers << " workers does not run again after an exception." << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+int main() {
+  unsigned int failures = 0;
+  const unsigned int sizes[] = { 0, 1, 2, 4, 8 };
+  for (unsigned int s = 0; s < 5; s++) {
+    failures += check_trees(sizes[s]);
+    failures += check_exception(sizes[s]);
+  }
+  if (failures > 0) {
+    std::cout << failures << " failed checks." << std::endl;
+    return 1;
+  }
+  std::cout << "All the tasks are run." << std::endl;
+  return 0;
+}
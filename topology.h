@@ -0,0 +1,208 @@
+/***************************************************************************
+*            topology.h
+*
+*  This file is used to describe the topology of a plant of watertanks,
+*  i.e. which tank flows into which one, along with the values of the
+*  parameters of each tank and of the controllers.
+*  The tanks with no upstream tanks have a constant input, the tank with
+*  no downstream tank loses water from the bottom.
+*
+*  Copyright  2018  Raffaello Corsini, Luca Geretti
+*
+****************************************************************************/
+
+/*
+*  This program is free software; you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation; either version 2 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Library General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program; if not, write to the Free Software
+*  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#ifndef TOPOLOGY_H
+#define TOPOLOGY_H
+
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace Ariadne {
+
+  // The modes of a valve and of a controller, as in getValve and getUrgentController.
+  enum ValveMode { VALVE_IDLE, VALVE_OPENING, VALVE_CLOSING };
+  enum ControllerMode { CONTROLLER_RISING, CONTROLLER_FALLING };
+
+  // A single tank of the plant.
+  struct TankDescription {
+    // Index of the tank this one flows into, -1 for the bottom tank.
+    int downstream;
+    // Constant input flow, used only when no tank flows into this one.
+    double input_flow;
+    // Output flow coefficient of the tank.
+    double output_flow;
+  };
+
+  /*
+  * The description of a whole plant. Every tank has a valve on its top
+  * and a controller for such valve, all sharing the same parameters.
+  */
+  struct PlantTopology {
+    std::vector<TankDescription> tanks;
+    // Time constant for opening/closing the valves.
+    double opening_time;
+    // Thresholds of the controllers.
+    double hmin;
+    double hmax;
+    // Indetermination constant of the non-urgent controllers.
+    double delta;
+    // Whether the controllers switch as soon as a threshold is reached (getUrgentController)
+    // or anywhere within delta of it (getController).
+    bool urgent_controllers;
+
+    PlantTopology() : opening_time(4.0), hmin(5.75), hmax(7.75), delta(0.002), urgent_controllers(true) { }
+
+    unsigned int size() const { return tanks.size(); }
+
+    // The tanks flowing into the given one.
+    std::vector<unsigned int> upstream(unsigned int k) const {
+      std::vector<unsigned int> result;
+      for (unsigned int i = 0; i < tanks.size(); i++){
+        if (tanks.at(i).downstream == (int)k)
+          result.push_back(i);
+      }
+      return result;
+    }
+
+    // Whether the given tank has a constant input instead of upstream tanks.
+    bool is_source(unsigned int k) const { return upstream(k).empty(); }
+
+    // Whether the given tank is the bottom one.
+    bool is_bottom(unsigned int k) const { return tanks.at(k).downstream < 0; }
+
+    // Checks that the tanks form a tree flowing into a single bottom tank.
+    void check() const {
+      if (tanks.size() < 2)
+        throw std::invalid_argument("A plant needs at least two tanks.");
+      unsigned int bottoms = 0;
+      for (unsigned int k = 0; k < tanks.size(); k++){
+        int downstream = tanks.at(k).downstream;
+        if (downstream < 0){
+          bottoms++;
+          continue;
+        }
+        if (downstream >= (int)tanks.size() || downstream == (int)k)
+          throw std::invalid_argument("Tank " + std::to_string(k) + " flows into a missing tank.");
+        // Following the flow from any tank must lead to the bottom tank.
+        unsigned int steps = 0;
+        for (int j = downstream; j >= 0; j = tanks.at(j).downstream){
+          if (++steps > tanks.size())
+            throw std::invalid_argument("Tank " + std::to_string(k) + " is part of a cycle.");
+        }
+      }
+      if (bottoms != 1)
+        throw std::invalid_argument("A plant needs exactly one bottom tank.");
+    }
+  };
+
+  /*
+  * A textual description of the plant, listing the structure and all the
+  * parameter values: two plants with the same description give the same system.
+  */
+  std::string describe(const PlantTopology& topology) {
+    std::ostringstream description;
+    description.precision(17);
+    description << "T=" << topology.opening_time << ";hmin=" << topology.hmin
+                << ";hmax=" << topology.hmax << ";delta=" << topology.delta;
+    // Left out for the urgent controllers, so that the descriptions of the plants did not change with the option.
+    if (!topology.urgent_controllers)
+      description << ";controllers=delta";
+    for (unsigned int k = 0; k < topology.size(); k++){
+      const TankDescription& tank = topology.tanks.at(k);
+      description << ";tank" << k << ":" << tank.downstream << "," << tank.input_flow << "," << tank.output_flow;
+    }
+    return description.str();
+  }
+
+  // A 64 bit FNV-1a hash of a text.
+  uint64_t text_hash(const std::string& text) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (unsigned int i = 0; i < text.size(); i++){
+      hash ^= (unsigned char)text[i];
+      hash *= 1099511628211ULL;
+    }
+    return hash;
+  }
+
+  // A 64 bit FNV-1a hash of the description of the plant.
+  uint64_t topology_hash(const PlantTopology& topology) {
+    return text_hash(describe(topology));
+  }
+
+  /*
+  * A textual description of the structure of the plant only, i.e. of which
+  * tank flows into which one: two plants with the same structure have the
+  * same variables and locations, whatever their parameter values.
+  */
+  std::string describe_structure(const PlantTopology& topology) {
+    std::ostringstream description;
+    description << "tanks=" << topology.size();
+    for (unsigned int k = 0; k < topology.size(); k++){
+      description << ";tank" << k << ":" << topology.tanks.at(k).downstream;
+    }
+    return description.str();
+  }
+
+  // A 64 bit FNV-1a hash of the description of the structure of the plant.
+  uint64_t structure_hash(const PlantTopology& topology) {
+    return text_hash(describe_structure(topology));
+  }
+
+  /*
+  * A binary tree of n tanks: tank k (counted backwards from the bottom tank
+  * n-1) flows into the tank above it in heap order. With three tanks this is
+  * the original plant, with tanks 0 and 1 flowing into tank 2.
+  */
+  PlantTopology getBinaryTreeTopology(unsigned int n) {
+    PlantTopology topology;
+    for (unsigned int k = 0; k < n; k++){
+      unsigned int heap_index = n - 1 - k;
+      TankDescription tank;
+      tank.downstream = (heap_index == 0 ? -1 : (int)(n - 1 - (heap_index - 1) / 2));
+      tank.input_flow = 0.5;
+      tank.output_flow = 0.04;
+      topology.tanks.push_back(tank);
+    }
+    return topology;
+  }
+
+  // A chain of n tanks, where tank k flows into tank k+1.
+  PlantTopology getCascadeTopology(unsigned int n) {
+    PlantTopology topology;
+    for (unsigned int k = 0; k < n; k++){
+      TankDescription tank;
+      tank.downstream = (k + 1 < n ? (int)(k + 1) : -1);
+      tank.input_flow = 0.5;
+      tank.output_flow = 0.04;
+      topology.tanks.push_back(tank);
+    }
+    return topology;
+  }
+
+  // The original plant: two side tanks on the top flowing into a bottom tank.
+  PlantTopology getPyramidTopology() {
+    return getBinaryTreeTopology(3);
+  }
+
+}
+
+#endif
@@ -0,0 +1,185 @@
+/***************************************************************************
+*            work-stealing-pool.h
+*
+*  This file is used to describe a small pool of worker threads.
+*  Every worker owns a queue of tasks: it takes the most recent task
+*  from its own queue and, when this is empty, it steals the oldest
+*  task from the queue of another worker. A task can submit new tasks
+*  to the queue of the worker running it. An idle worker sleeps until a
+*  task is submitted or none is pending. The first exception thrown by
+*  a task is rethrown by run(), once the workers have stopped; the tasks
+*  not started yet are then dropped.
+*
+*  Copyright  2018  Raffaello Corsini, Luca Geretti
+*
+****************************************************************************/
+
+/*
+*  This program is free software; you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation; either version 2 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU Library General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program; if not, write to the Free Software
+*  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#ifndef WORK_STEALING_POOL_H
+#define WORK_STEALING_POOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Ariadne {
+
+  class WorkStealingPool {
+
+    public:
+
+      // A task receives the pool and the index of the worker running it,
+      // so that it can submit further tasks or use per-worker resources.
+      typedef std::function<void(WorkStealingPool&,unsigned int)> Task;
+
+    private:
+
+      // The queue of a worker, along with the lock protecting it.
+      struct WorkerQueue {
+        std::mutex lock;
+        std::deque<Task> tasks;
+      };
+
+      std::vector< std::unique_ptr<WorkerQueue> > _queues;
+      // Protects the counters and the error below; taken before the lock of a queue, never after.
+      std::mutex _lock;
+      // Notified when a task is submitted or when none is pending.
+      std::condition_variable _changed;
+      // Tasks submitted and not yet completed.
+      unsigned int _pending;
+      // Tasks submitted so far, telling an idle worker whether any was submitted since it looked.
+      unsigned long _submitted;
+      // The first exception thrown by a task.
+      std::exception_ptr _error;
+      // Used to spread the tasks submitted from outside the workers.
+      unsigned int _next_queue;
+
+    public:
+
+      // Creates a pool with the given number of workers, at least one.
+      WorkStealingPool(unsigned int workers) : _pending(0), _submitted(0), _next_queue(0) {
+        if (workers == 0)
+          workers = 1;
+        for (unsigned int i = 0; i < workers; i++)
+          _queues.push_back(std::unique_ptr<WorkerQueue>(new WorkerQueue()));
+      }
+
+      unsigned int size() const { return _queues.size(); }
+
+      // Submits a task from outside the workers, round robin on the queues.
+      void submit(const Task& task) {
+        submit(_next_queue, task);
+        _next_queue = (_next_queue + 1) % _queues.size();
+      }
+
+      // Submits a task to the queue of the given worker.
+      void submit(unsigned int worker, const Task& task) {
+        {
+          std::lock_guard<std::mutex> guard(_lock);
+          _pending++;
+          std::lock_guard<std::mutex> queue_guard(_queues[worker]->lock);
+          _queues[worker]->tasks.push_back(task);
+          _submitted++;
+        }
+        _changed.notify_one();
+      }
+
+      // Runs all the tasks, including those submitted while running, and returns when
+      // none is left, rethrowing the first exception thrown by a task, if any.
+      void run() {
+        std::vector<std::thread> threads;
+        for (unsigned int i = 0; i < _queues.size(); i++)
+          threads.push_back(std::thread(&WorkStealingPool::_work, this, i));
+        for (unsigned int i = 0; i < threads.size(); i++)
+          threads[i].join();
+        if (_error) {
+          std::exception_ptr error = _error;
+          _error = std::exception_ptr();
+          std::rethrow_exception(error);
+        }
+      }
+
+    private:
+
+      // Takes the most recent task of the worker's own queue.
+      bool _take_own(unsigned int worker, Task& task) {
+        std::lock_guard<std::mutex> guard(_queues[worker]->lock);
+        if (_queues[worker]->tasks.empty())
+          return false;
+        task = _queues[worker]->tasks.back();
+        _queues[worker]->tasks.pop_back();
+        return true;
+      }
+
+      // Takes the oldest task of the queue of any other worker.
+      bool _steal(unsigned int worker, Task& task) {
+        for (unsigned int i = 1; i < _queues.size(); i++) {
+          WorkerQueue& victim = *_queues[(worker + i) % _queues.size()];
+          std::lock_guard<std::mutex> guard(victim.lock);
+          if (!victim.tasks.empty()) {
+            task = victim.tasks.front();
+            victim.tasks.pop_front();
+            return true;
+          }
+        }
+        return false;
+      }
+
+      void _work(unsigned int worker) {
+        Task task;
+        while (true) {
+          unsigned long submitted;
+          bool failed;
+          {
+            std::lock_guard<std::mutex> guard(_lock);
+            if (_pending == 0)
+              return;
+            submitted = _submitted;
+            failed = (bool)_error;
+          }
+          if (_take_own(worker,task) || _steal(worker,task)) {
+            // After a failure the tasks are dropped, as the run is going to throw anyway
+            if (!failed) {
+              try {
+                task(*this,worker);
+              } catch (...) {
+                std::lock_guard<std::mutex> guard(_lock);
+                if (!_error)
+                  _error = std::current_exception();
+              }
+            }
+            std::lock_guard<std::mutex> guard(_lock);
+            if (--_pending == 0)
+              _changed.notify_all();
+          } else {
+            // Some task is still running and may submit more
+            std::unique_lock<std::mutex> lock(_lock);
+            _changed.wait(lock,[&]() { return _pending == 0 || _submitted != submitted; });
+          }
+        }
+      }
+  };
+
+}
+
+#endif